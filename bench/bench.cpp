@@ -0,0 +1,273 @@
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "src/viewer.h"
+#include "src/resourcemanager.h"
+#include "src/search.h"
+#include "src/layout/singlelayout.h"
+#include "src/layout/gridlayout.h"
+
+using namespace std;
+
+
+// drives the layouts like the canvas does, but paints into an offscreen image
+class Bench {
+public:
+	Bench(Viewer *v, int width, int height, int timeout);
+
+	void reset();
+	// paints and waits until all visible pages are rendered
+	void frame(Layout *layout);
+	void search(const QString &term);
+	void print(const char *name) const;
+
+private:
+	double paint(Layout *layout);
+
+	Viewer *viewer;
+	ResourceManager *res;
+	QImage image;
+	int timeout;
+
+	int frames;
+	double paint_total, paint_max;
+	double ready_total, ready_max;
+	int queue_max;
+};
+
+Bench::Bench(Viewer *v, int width, int height, int timeout) :
+		viewer(v),
+		res(v->get_res()),
+		image(width, height, QImage::Format_RGB32),
+		timeout(timeout) {
+	reset();
+}
+
+void Bench::reset() {
+	frames = 0;
+	paint_total = paint_max = 0;
+	ready_total = ready_max = 0;
+	queue_max = 0;
+	// start every sequence with a cold cache
+	res->collect_garbage(0, -1);
+}
+
+double Bench::paint(Layout *layout) {
+	QElapsedTimer timer;
+	timer.start();
+	QPainter painter(&image);
+	painter.fillRect(image.rect(), Qt::black);
+	layout->render(&painter);
+	painter.end();
+	return timer.nsecsElapsed() / 1000000.0;
+}
+
+void Bench::frame(Layout *layout) {
+	QElapsedTimer ready;
+	ready.start();
+
+	double time = paint(layout);
+	frames++;
+	paint_total += time;
+	paint_max = max(paint_max, time);
+	queue_max = max(queue_max, res->get_queue_length());
+
+	// repaint until a paint finds every visible page rendered at its size
+	// a paint requests every missing page again, including one the worker
+	// already took from the queue and is still rendering; so only an empty
+	// queue right after a paint means done
+	// overview pages come from the atlas, which counts its busy tile itself
+	while (ready.elapsed() < timeout) {
+		QCoreApplication::processEvents(QEventLoop::AllEvents, 5);
+		usleep(1000);
+		paint(layout);
+		if (res->get_queue_length(true) == 0 && res->get_overview_queue_length() == 0) {
+			break;
+		}
+	}
+
+	time = ready.nsecsElapsed() / 1000000.0;
+	ready_total += time;
+	ready_max = max(ready_max, time);
+
+	// let queued prefetches finish, so they don't slow down the next frame
+	while (ready.elapsed() < timeout && res->get_queue_length() > 0) {
+		QCoreApplication::processEvents(QEventLoop::AllEvents, 5);
+		usleep(1000);
+	}
+}
+
+void Bench::search(const QString &term) {
+	QEventLoop loop;
+	QTimer::singleShot(timeout, &loop, SLOT(quit()));
+	QObject::connect(viewer->get_search_bar(), SIGNAL(search_finished()), &loop, SLOT(quit()));
+
+	QElapsedTimer timer;
+	timer.start();
+	viewer->get_search_bar()->search(term);
+	loop.exec();
+
+	frames++;
+	ready_total = ready_max = timer.nsecsElapsed() / 1000000.0;
+}
+
+void Bench::print(const char *name) const {
+	if (frames == 0) {
+		return;
+	}
+	cout << left << setw(14) << name << right << fixed << setprecision(2)
+		<< setw(7) << frames
+		<< setw(12) << paint_total / frames << setw(12) << paint_max
+		<< setw(12) << ready_total / frames << setw(12) << ready_max
+		<< setw(8) << queue_max << endl;
+}
+
+
+static void print_help(char *name) {
+	cout << "Usage:" << endl;
+	cout << "  " << name << " [OPTIONS] FILE" << endl;
+	cout << endl;
+	cout << "Renders scripted scroll, zoom, column and search sequences offscreen and" << endl;
+	cout << "reports paint times, time until visible pages are rendered (ms) and queue depth." << endl;
+	cout << "Paints into an image, but the viewer is a widget and Qt 4 needs an X display" << endl;
+	cout << "for those, e.g. run it with xvfb-run." << endl;
+	cout << endl;
+	cout << "Settings:" << endl;
+	cout << "  -W, --width NUM          Width of the offscreen view (1024)" << endl;
+	cout << "  -H, --height NUM         Height of the offscreen view (768)" << endl;
+	cout << "  -n, --steps NUM          Steps per sequence (50)" << endl;
+	cout << "  -s, --search TERM        Term for the search sequence (the)" << endl;
+	cout << "  -t, --timeout NUM        Milliseconds to wait for a frame (30000)" << endl;
+	cout << "  -h, --help               Print this help and exit" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	QApplication app(argc, argv);
+
+	struct option long_options[] = {
+		{"width",		required_argument,	NULL,	'W'},
+		{"height",		required_argument,	NULL,	'H'},
+		{"steps",		required_argument,	NULL,	'n'},
+		{"search",		required_argument,	NULL,	's'},
+		{"timeout",		required_argument,	NULL,	't'},
+		{"help",		no_argument,		NULL,	'h'},
+		{NULL, 0, NULL, 0}
+	};
+	int width = 1024, height = 768;
+	int steps = 50;
+	int timeout = 30000;
+	QString term = "the";
+	while (1) {
+		int c = getopt_long(argc, argv, "W:H:n:s:t:h", long_options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+			case 'W':
+				width = atoi(optarg);
+				break;
+			case 'H':
+				height = atoi(optarg);
+				break;
+			case 'n':
+				steps = atoi(optarg);
+				break;
+			case 's':
+				term = QString::fromUtf8(optarg);
+				break;
+			case 't':
+				timeout = atoi(optarg);
+				break;
+			case 'h':
+				print_help(argv[0]);
+				return 0;
+			default:
+				// getopt prints an error message
+				return 1;
+		}
+	}
+	if (optind != argc - 1) {
+		print_help(argv[0]);
+		return 1;
+	}
+
+	Viewer viewer(QString::fromUtf8(argv[optind]));
+	if (!viewer.is_valid() || !viewer.get_res()->is_valid()) {
+		cerr << "failed to open " << argv[optind] << endl;
+		return 1;
+	}
+	ResourceManager *res = viewer.get_res();
+	int pages = res->get_page_count();
+
+	Bench bench(&viewer, width, height, timeout);
+	SingleLayout single(&viewer, 0);
+	single.resize(width, height);
+	GridLayout grid(&viewer, 0);
+	grid.resize(width, height);
+
+	cout << pages << " pages, " << width << "x" << height << endl;
+	cout << left << setw(14) << "sequence" << right
+		<< setw(7) << "frames"
+		<< setw(12) << "paint avg" << setw(12) << "paint max"
+		<< setw(12) << "ready avg" << setw(12) << "ready max"
+		<< setw(8) << "queue" << endl;
+
+	// page by page
+	bench.reset();
+	single.scroll_page(0, false);
+	bench.frame(&single);
+	for (int i = 0; i < steps && i < pages - 1; i++) {
+		single.scroll_page(1);
+		bench.frame(&single);
+	}
+	bench.print("single-page");
+
+	// smooth scrolling, a quarter screen per frame
+	bench.reset();
+	grid.scroll_page(0, false);
+	bench.frame(&grid);
+	for (int i = 0; i < steps; i++) {
+		grid.scroll_smooth(0, -height / 4);
+		bench.frame(&grid);
+	}
+	bench.print("grid-scroll");
+
+	// zoom in and back out
+	bench.reset();
+	for (int i = 0; i < steps; i++) {
+		grid.set_zoom(i < steps / 2 ? 1 : -1);
+		bench.frame(&grid);
+	}
+	grid.set_zoom(0, false);
+	bench.print("grid-zoom");
+
+	// page walls with more and more columns
+	bench.reset();
+	for (int i = 0; i < steps; i++) {
+		grid.set_columns(i < steps / 2 ? 1 : -1);
+		bench.frame(&grid);
+	}
+	grid.set_columns(1, false);
+	bench.print("grid-columns");
+
+	bench.reset();
+	bench.search(term);
+	bench.print("search");
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		cout << "peak rss: " << usage.ru_maxrss / 1024 << " MiB" << endl;
+	}
+	return 0;
+}
+
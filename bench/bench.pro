@@ -0,0 +1,6 @@
+TEMPLATE = app
+TARGET = katarakt-bench
+
+include(../katarakt.pri)
+
+SOURCES +=  bench.cpp
@@ -0,0 +1,26 @@
+# sources shared by katarakt and the benchmark
+DEPENDPATH += $$PWD
+INCLUDEPATH += $$PWD
+CONFIG += qt
+QT += network xml dbus
+
+DEFINES += "POPPLER_VERSION_MAJOR=`pkg-config --modversion poppler-qt4 | cut -d . -f 1`"
+DEFINES += "POPPLER_VERSION_MINOR=`pkg-config --modversion poppler-qt4 | cut -d . -f 2`"
+DEFINES += "POPPLER_VERSION_MICRO=`pkg-config --modversion poppler-qt4 | cut -d . -f 3`"
+
+QMAKE_CXXFLAGS_DEBUG += -DDEBUG
+
+HEADERS +=  $$PWD/src/layout/layout.h $$PWD/src/layout/singlelayout.h $$PWD/src/layout/smoothlayout.h $$PWD/src/layout/gridlayout.h $$PWD/src/layout/continuouslayout.h $$PWD/src/layout/presenterlayout.h \
+            $$PWD/src/viewer.h $$PWD/src/canvas.h $$PWD/src/resourcemanager.h $$PWD/src/grid.h $$PWD/src/search.h $$PWD/src/gotoline.h $$PWD/src/config.h \
+            $$PWD/src/download.h $$PWD/src/util.h $$PWD/src/kpage.h $$PWD/src/worker.h $$PWD/src/beamerwindow.h $$PWD/src/toc.h $$PWD/src/splitter.h $$PWD/src/selection.h \
+            $$PWD/src/dbus/source_correlate.h $$PWD/src/dbus/dbus.h $$PWD/src/prefetchplanner.h $$PWD/src/atlas.h \
+            $$PWD/src/stats.h $$PWD/src/dbus/stats_export.h $$PWD/src/dbus/control.h $$PWD/src/trace.h $$PWD/src/rasterizer.h $$PWD/src/shmcache.h $$PWD/src/rangesource.h $$PWD/src/downloadmanager.h \
+            $$PWD/src/documentloader.h $$PWD/src/documentpool.h $$PWD/src/synctex.h $$PWD/src/loaderthread.h
+
+SOURCES +=  $$PWD/src/layout/layout.cpp $$PWD/src/layout/singlelayout.cpp $$PWD/src/layout/smoothlayout.cpp $$PWD/src/layout/gridlayout.cpp $$PWD/src/layout/continuouslayout.cpp $$PWD/src/layout/presenterlayout.cpp \
+            $$PWD/src/viewer.cpp $$PWD/src/canvas.cpp $$PWD/src/resourcemanager.cpp $$PWD/src/grid.cpp $$PWD/src/search.cpp $$PWD/src/gotoline.cpp $$PWD/src/config.cpp \
+            $$PWD/src/download.cpp $$PWD/src/util.cpp $$PWD/src/kpage.cpp $$PWD/src/worker.cpp $$PWD/src/beamerwindow.cpp $$PWD/src/toc.cpp $$PWD/src/splitter.cpp \
+            $$PWD/src/selection.cpp $$PWD/src/dbus/source_correlate.cpp $$PWD/src/dbus/dbus.cpp $$PWD/src/prefetchplanner.cpp $$PWD/src/atlas.cpp \
+            $$PWD/src/stats.cpp $$PWD/src/dbus/stats_export.cpp $$PWD/src/dbus/control.cpp $$PWD/src/trace.cpp $$PWD/src/rasterizer.cpp $$PWD/src/shmcache.cpp $$PWD/src/rangesource.cpp $$PWD/src/downloadmanager.cpp \
+            $$PWD/src/documentloader.cpp $$PWD/src/documentpool.cpp $$PWD/src/synctex.cpp $$PWD/src/loaderthread.cpp
+unix:LIBS += -lpoppler-qt4 -lrt -lz
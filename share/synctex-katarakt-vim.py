@@ -34,7 +34,8 @@ Behaviour:
   line in the texfile.
 
   If the user presses ZE in the editor, a message is sent to this script.
-  This script calls synctex and sends the pdf-coordinates to katarakt.
+  This script sends the source position to katarakt, which looks it up in the
+  .synctex.gz file itself.
 
   When katarakt quits, then this script exits as well.
 
@@ -122,10 +123,6 @@ vim_view_keybind = os.getenv('VIM_KEY', 'ZE')
 pdfprocess = subprocess.Popen(['katarakt', '--single-instance', 'false', pdf_filename])
 pdf_pid = pdfprocess.pid
 
-view_command = ("qdbus katarakt.pid%d" % pdf_pid +
-                " / katarakt.SourceCorrelate.view" +
-                " %{output} %{page} %{x} %{y}")
-
 # connect to dbus
 bus = dbus.SessionBus()
 
@@ -155,12 +152,7 @@ class BridgeObject(dbus.service.Object):
                          in_signature='sii', out_signature='')
 
     def View(self, filename, line, col):
-        subprocess.call([
-            "synctex", "view",
-            "-i", "%d:%d:%s" % (line,col,filename),
-            "-o", pdf_filename,
-            "-x", view_command,
-        ])
+        iface.view_source(os.path.abspath(filename), line, col)
 
 # create the dbus object and bind it to the bus
 BridgeObject('/')
@@ -180,16 +172,14 @@ if returncode != 0:
 
 
 
-# callback if the signal for edit is sent by katarakt
-def on_edit(filename,page,x,y):
-    #print ("go to page %d at %d,%d" % (page,x,y))
+# callback if the signal for edit_source is sent by katarakt
+def on_edit_source(filename,line,column):
     subprocess.call([
-        "synctex", "edit",
-        "-o", ("%d:%d:%d:%s" % (1+page,x,y,filename)),
-        "-x", "vim --servername '" + vim_session + "' --remote-silent '+%{line}' %{input}",
+        "vim", "--servername", vim_session,
+        "--remote-silent", "+%d" % line, filename,
         ])
 
-iface.connect_to_signal("edit", on_edit)
+iface.connect_to_signal("edit_source", on_edit_source)
 
 
 # Main loop and cleanup:
@@ -0,0 +1,261 @@
+#include "atlas.h"
+#include "rangesource.h"
+#include "documentpool.h"
+#include <QPainter>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+
+AtlasTile::AtlasTile(int width, int height, int pages, bool inverted) :
+		img(width, height, QImage::Format_RGB32),
+		cells(pages),
+		inverted_colors(inverted) {
+	img.fill(0xffffffff);
+}
+
+
+Atlas::Atlas(const QString &file, DocumentPool *pool, int page_count,
+		int page_size, int tile_pages) :
+		file(file),
+		pool(pool),
+		doc(NULL),
+		load_failed(false),
+		page_count(page_count),
+		busy_tile(-1),
+		center_tile(0),
+		die(false),
+		page_size(page_size),
+		tile_pages(tile_pages) {
+	if (this->tile_pages < 1) {
+		this->tile_pages = 1;
+	}
+	// as square as possible
+	tile_columns = ceil(sqrt((float) this->tile_pages));
+	pool->ref();
+}
+
+Atlas::~Atlas() {
+	die = true;
+	requestSemaphore.release(1);
+	wait();
+
+	for (map<int,AtlasTile *>::iterator it = tiles.begin(); it != tiles.end(); ++it) {
+		delete it->second;
+	}
+	pool->release(doc);
+	pool->deref();
+}
+
+void Atlas::run() {
+	while (1) {
+		requestSemaphore.acquire(1);
+		if (die) {
+			break;
+		}
+
+		// take the tile closest to the view
+		mutex.lock();
+		if (requests.empty()) { // removed by collect_garbage
+			mutex.unlock();
+			continue;
+		}
+		set<int>::iterator it = requests.lower_bound(center_tile);
+		if (it == requests.end()) {
+			--it;
+		} else if (it != requests.begin()) {
+			set<int>::iterator less = it;
+			--less;
+			if (center_tile - *less < *it - center_tile) {
+				it = less;
+			}
+		}
+		int tile_index = *it;
+		requests.erase(it);
+		busy_tile = tile_index;
+		mutex.unlock();
+
+		// take a separate document on first use
+		if (doc == NULL && !load_failed) {
+			doc = pool->acquire();
+			if (doc == NULL || doc->isLocked()) {
+				cerr << "failed to open document for the overview" << endl;
+				pool->release(doc);
+				doc = NULL;
+				load_failed = true;
+			} else {
+				doc->setRenderHint(Poppler::Document::Antialiasing, true);
+				doc->setRenderHint(Poppler::Document::TextAntialiasing, true);
+			}
+		}
+		if (doc != NULL) {
+			render_tile(tile_index);
+		}
+
+		mutex.lock();
+		busy_tile = -1;
+		mutex.unlock();
+	}
+}
+
+bool Atlas::draw_page(QPainter *painter, int page, const QRect &rect,
+		int rotation, bool inverted_colors) {
+	if (page < 0 || page >= page_count) {
+		return false;
+	}
+
+	mutex.lock();
+	AtlasTile *tile = get_tile(page, inverted_colors);
+	const QRect &cell = tile->cells[page % tile_pages];
+	if (cell.isEmpty()) {
+		mutex.unlock();
+		return false;
+	}
+	// adjust to current color setting
+	if (tile->inverted_colors != inverted_colors) {
+		tile->inverted_colors = inverted_colors;
+		tile->img.invertPixels();
+	}
+
+	// cells are not rotated, same transformation as for full renderings
+	QRect target;
+	painter->rotate(rotation * 90);
+	if (rotation == 0) {
+		target = rect;
+	} else if (rotation == 1) {
+		target = QRect(rect.y(), -rect.x() - rect.width(),
+				rect.height(), rect.width());
+	} else if (rotation == 2) {
+		target = QRect(-rect.x() - rect.width(), -rect.y() - rect.height(),
+				rect.width(), rect.height());
+	} else if (rotation == 3) {
+		target = QRect(-rect.y() - rect.height(), rect.x(),
+				rect.height(), rect.width());
+	}
+	painter->drawImage(target, tile->img, cell);
+	painter->rotate(-rotation * 90);
+	mutex.unlock();
+	return true;
+}
+
+void Atlas::request(int page, bool inverted_colors) {
+	if (page < 0 || page >= page_count) {
+		return;
+	}
+	mutex.lock();
+	get_tile(page, inverted_colors);
+	mutex.unlock();
+}
+
+void Atlas::collect_garbage(int keep_min, int keep_max) {
+	mutex.lock();
+	center_tile = max((keep_min + keep_max) / 2, 0) / tile_pages;
+	// drop tiles that don't overlap the kept range
+	for (map<int,AtlasTile *>::iterator it = tiles.begin(); it != tiles.end(); ) {
+		int first = it->first * tile_pages;
+		int last = first + tile_pages - 1;
+		if (last < keep_min || first > keep_max) {
+#ifdef DEBUG
+			cerr << "    removing atlas tile " << it->first << endl;
+#endif
+			requests.erase(it->first);
+			delete it->second;
+			tiles.erase(it++);
+		} else {
+			++it;
+		}
+	}
+	mutex.unlock();
+}
+
+int Atlas::get_queue_length() {
+	mutex.lock();
+	int length = requests.size();
+	if (busy_tile >= 0) {
+		length++;
+	}
+	mutex.unlock();
+	return length;
+}
+
+AtlasTile *Atlas::get_tile(int page, bool inverted_colors) {
+	int tile_index = page / tile_pages;
+	map<int,AtlasTile *>::iterator it = tiles.find(tile_index);
+	if (it != tiles.end()) {
+		return it->second;
+	}
+
+	int rows = (tile_pages + tile_columns - 1) / tile_columns;
+	AtlasTile *tile = new AtlasTile(tile_columns * page_size, rows * page_size,
+			tile_pages, inverted_colors);
+	tiles[tile_index] = tile;
+	requests.insert(tile_index);
+	requestSemaphore.release(1);
+	return tile;
+}
+
+void Atlas::render_tile(int tile_index) {
+	int first = tile_index * tile_pages;
+	int last = min(first + tile_pages, page_count);
+	for (int page = first; page < last; page++) {
+		if (die) {
+			return;
+		}
+		int cell_index = page - first;
+
+		mutex.lock();
+		map<int,AtlasTile *>::iterator it = tiles.find(tile_index);
+		if (it == tiles.end()) { // evicted in the meantime
+			mutex.unlock();
+			return;
+		}
+		bool done = !it->second->cells[cell_index].isEmpty();
+		mutex.unlock();
+		if (done) {
+			continue;
+		}
+
+		RangeSource *source = RangeSource::find(file);
+		if (source != NULL) {
+			source->fetch_page(page);
+		}
+		Poppler::Page *p = doc->page(page);
+		if (p == NULL) {
+			cerr << "failed to load page " << page << endl;
+			continue;
+		}
+		// fit the longer side into the cell
+		QSizeF page_size_f = p->pageSizeF();
+		float dpi = 72.0f * page_size / max(page_size_f.width(), page_size_f.height());
+		QImage img = p->renderToImage(dpi, dpi);
+		delete p;
+
+		if (img.isNull()) {
+			cerr << "failed to render page " << page << endl;
+			continue;
+		}
+
+		mutex.lock();
+		it = tiles.find(tile_index);
+		if (it == tiles.end()) {
+			mutex.unlock();
+			return;
+		}
+		AtlasTile *tile = it->second;
+		if (tile->inverted_colors) {
+			img.invertPixels();
+		}
+		QRect cell((cell_index % tile_columns) * page_size,
+				(cell_index / tile_columns) * page_size,
+				min(img.width(), page_size), min(img.height(), page_size));
+		QPainter painter(&tile->img);
+		painter.drawImage(cell.topLeft(), img, QRect(QPoint(0, 0), cell.size()));
+		painter.end();
+		tile->cells[cell_index] = cell;
+		mutex.unlock();
+
+		emit page_rendered(page);
+	}
+}
+
@@ -0,0 +1,80 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <poppler/qt4/poppler-qt4.h>
+#include <QThread>
+#include <QMutex>
+#include <QSemaphore>
+#include <QImage>
+#include <QVector>
+#include <QRect>
+#include <map>
+#include <set>
+
+
+class QPainter;
+class DocumentPool;
+
+
+// one image holding the low resolution renderings of a group of pages
+class AtlasTile {
+public:
+	AtlasTile(int width, int height, int pages, bool inverted);
+
+	QImage img;
+	QVector<QRect> cells; // stays empty until the page is rendered
+	bool inverted_colors;
+};
+
+
+// renders many pages at low resolution into few large images
+// used for overviews, where rendering every page on its own would be wasteful
+class Atlas : public QThread {
+	Q_OBJECT
+
+public:
+	Atlas(const QString &file, DocumentPool *pool, int page_count,
+			int page_size, int tile_pages);
+	~Atlas();
+
+	void run();
+
+	// draws the page into rect, rotated by rotation * 90 degrees
+	// returns false and requests the page's tile if it is not available yet
+	bool draw_page(QPainter *painter, int page, const QRect &rect,
+			int rotation, bool inverted_colors);
+	void request(int page, bool inverted_colors);
+	void collect_garbage(int keep_min, int keep_max);
+	// number of tiles waiting or being rendered
+	int get_queue_length();
+
+signals:
+	void page_rendered(int page);
+
+private:
+	// expects the mutex to be locked
+	AtlasTile *get_tile(int page, bool inverted_colors);
+	void render_tile(int tile_index);
+
+	// the worker's document can only be used by one thread
+	QString file;
+	DocumentPool *pool;
+	Poppler::Document *doc;
+	bool load_failed;
+	int page_count;
+
+	QMutex mutex;
+	QSemaphore requestSemaphore;
+	std::map<int,AtlasTile *> tiles;
+	std::set<int> requests;
+	int busy_tile; // -1 while idle
+	int center_tile;
+	volatile bool die;
+
+	int page_size;
+	int tile_pages;
+	int tile_columns;
+};
+
+#endif
+
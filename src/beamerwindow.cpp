@@ -7,6 +7,7 @@
 #include <QResizeEvent>
 #include <QApplication>
 #include <iostream>
+#include <set>
 
 using namespace std;
 
@@ -21,6 +22,7 @@ BeamerWindow::BeamerWindow(Viewer *v, QWidget *parent) :
 
 	CFG *config = CFG::get_instance();
 	mouse_wheel_factor = config->get_value("Settings/mouse_wheel_factor").toInt();
+	prerender_count = config->get_value("Settings/presenter_prerender_count").toInt();
 
 	switch (config->get_value("Settings/click_link_button").toInt()) {
 		case 1: click_link_button = Qt::LeftButton; break;
@@ -57,6 +59,8 @@ void BeamerWindow::paintEvent(QPaintEvent * /*event*/) {
 	QPainter painter(this);
 	painter.fillRect(rect(), QColor(0, 0, 0));
 	layout->render(&painter);
+	// upcoming slides at exactly the beamer's size
+	layout->prerender(prerender_count);
 }
 
 void BeamerWindow::mousePressEvent(QMouseEvent *event) {
@@ -89,6 +93,11 @@ void BeamerWindow::resizeEvent(QResizeEvent *event) {
 	update();
 }
 
+void BeamerWindow::hideEvent(QHideEvent * /*event*/) {
+	// no talk, no need to keep slides around
+	viewer->get_res()->set_pinned(set<int>());
+}
+
 void BeamerWindow::page_rendered(int page) {
 	if (layout->page_visible(page)) {
 		update();
@@ -6,6 +6,7 @@
 
 class Viewer;
 class Layout;
+class SingleLayout;
 
 // TODO make subclass of Canvas?
 class BeamerWindow : public QWidget {
@@ -29,17 +30,19 @@ protected:
 	void mouseReleaseEvent(QMouseEvent *event);
 	void wheelEvent(QWheelEvent *event);
 	void resizeEvent(QResizeEvent *event);
+	void hideEvent(QHideEvent *event);
 
 private slots:
 	void page_rendered(int page);
 
 private:
 	Viewer *viewer;
-	Layout *layout;
+	SingleLayout *layout;
 
 	int mx_down, my_down;
 
 	int mouse_wheel_factor;
+	int prerender_count;
 
 	Qt::MouseButton click_link_button;
 
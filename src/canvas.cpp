@@ -7,12 +7,14 @@
 #include <QDesktopWidget>
 #include <QTimer>
 #include <QLabel>
+#include <QElapsedTimer>
 #include <iostream>
 #include "canvas.h"
 #include "viewer.h"
 #include "layout/layout.h"
 #include "layout/singlelayout.h"
 #include "layout/gridlayout.h"
+#include "layout/continuouslayout.h"
 #include "layout/presenterlayout.h"
 #include "resourcemanager.h"
 #include "search.h"
@@ -20,6 +22,8 @@
 #include "config.h"
 #include "beamerwindow.h"
 #include "util.h"
+#include "stats.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -83,11 +87,14 @@ Canvas::Canvas(Viewer *v, QWidget *parent) :
 
 	single_layout = new SingleLayout(viewer, 0);
 	grid_layout = new GridLayout(viewer, 0);
+	continuous_layout = new ContinuousLayout(viewer, 0);
 	presenter_layout = new PresenterLayout(viewer, 1);
 
 	QString default_layout = config->get_value("Settings/default_layout").toString();
 	if (default_layout == "grid") {
 		cur_layout = grid_layout;
+	} else if (default_layout == "continuous") {
+		cur_layout = continuous_layout;
 	} else if (default_layout == "presenter") {
 		cur_layout = presenter_layout;
 	} else { // "single" and everything else
@@ -115,6 +122,13 @@ Canvas::Canvas(Viewer *v, QWidget *parent) :
 	page_overlay->setAutoFillBackground(true);
 	page_overlay->show();
 
+	stats_overlay = new QLabel(this);
+	stats_overlay->setMargin(1);
+	stats_overlay->setAutoFillBackground(true);
+	stats_overlay->hide();
+	stats_timer.setInterval(500);
+	connect(&stats_timer, SIGNAL(timeout()), this, SLOT(update_stats_overlay()), Qt::UniqueConnection);
+
 	// setup beamer
 	BeamerWindow *beamer = viewer->get_beamer();
 	setup_keys(beamer);
@@ -129,9 +143,11 @@ Canvas::Canvas(Viewer *v, QWidget *parent) :
 
 Canvas::~Canvas() {
 	delete page_overlay;
+	delete stats_overlay;
 	delete goto_line;
 	delete single_layout;
 	delete grid_layout;
+	delete continuous_layout;
 	delete presenter_layout;
 }
 
@@ -150,9 +166,11 @@ void Canvas::setup_keys(QWidget *base) {
 
 	add_action(base, "Keys/set_single_layout", SLOT(set_single_layout()), this);
 	add_action(base, "Keys/set_grid_layout", SLOT(set_grid_layout()), this);
+	add_action(base, "Keys/set_continuous_layout", SLOT(set_continuous_layout()), this);
 	add_action(base, "Keys/set_presenter_layout", SLOT(set_presenter_layout()), this);
 
 	add_action(base, "Keys/toggle_overlay", SLOT(toggle_overlay()), this);
+	add_action(base, "Keys/toggle_stats", SLOT(toggle_stats()), this);
 	add_action(base, "Keys/swap_selection_and_panning_buttons", SLOT(swap_selection_and_panning_buttons()), this);
 }
 
@@ -173,6 +191,9 @@ void Canvas::paintEvent(QPaintEvent * /*event*/) {
 #ifdef DEBUG
 	cerr << "redraw" << endl;
 #endif
+	TraceScope scope("paint");
+	QElapsedTimer timer;
+	timer.start();
 	QPainter painter(this);
 	if (viewer->isFullScreen()) {
 		painter.fillRect(rect(), background_fullscreen);
@@ -180,6 +201,7 @@ void Canvas::paintEvent(QPaintEvent * /*event*/) {
 		painter.fillRect(rect(), background);
 	}
 	cur_layout->render(&painter);
+	Stats::get_instance()->record_paint(timer.nsecsElapsed() / 1000);
 }
 
 void Canvas::mousePressEvent(QMouseEvent *event) {
@@ -305,6 +327,21 @@ void Canvas::resizeEvent(QResizeEvent *event) {
 	page_overlay->move(width() - page_overlay->width(), height() - page_overlay->height());
 }
 
+bool Canvas::set_layout(const QString &name) {
+	if (name == "single") {
+		set_single_layout();
+	} else if (name == "grid") {
+		set_grid_layout();
+	} else if (name == "continuous") {
+		set_continuous_layout();
+	} else if (name == "presenter") {
+		set_presenter_layout();
+	} else {
+		return false;
+	}
+	return true;
+}
+
 // primitive actions
 void Canvas::set_single_layout() {
 	single_layout->activate(cur_layout);
@@ -325,6 +362,16 @@ void Canvas::set_grid_layout() {
 	viewer->activateWindow();
 }
 
+void Canvas::set_continuous_layout() {
+	continuous_layout->activate(cur_layout);
+	continuous_layout->rebuild();
+	cur_layout = continuous_layout;
+	update();
+	viewer->get_beamer()->hide();
+	viewer->show_progress(false);
+	viewer->activateWindow();
+}
+
 void Canvas::set_presenter_layout() {
 	presenter_layout->activate(cur_layout);
 	presenter_layout->rebuild();
@@ -347,6 +394,22 @@ void Canvas::toggle_overlay() {
 	page_overlay->setVisible(!page_overlay->isVisible());
 }
 
+void Canvas::toggle_stats() {
+	if (stats_overlay->isVisible()) {
+		stats_timer.stop();
+		stats_overlay->hide();
+	} else {
+		update_stats_overlay();
+		stats_overlay->show();
+		stats_timer.start();
+	}
+}
+
+void Canvas::update_stats_overlay() {
+	stats_overlay->setText(Stats::get_instance()->report());
+	stats_overlay->adjustSize();
+}
+
 void Canvas::focus_goto() {
 	goto_line->activateWindow();
 	goto_line->show();
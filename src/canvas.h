@@ -15,6 +15,7 @@ class Viewer;
 class Layout;
 class SingleLayout;
 class GridLayout;
+class ContinuousLayout;
 class PresenterLayout;
 class GotoLine;
 class QLabel;
@@ -33,6 +34,8 @@ public:
 	void set_search_visible(bool visible);
 
 	Layout *get_layout() const;
+	// "single", "grid", "continuous" or "presenter", false for others
+	bool set_layout(const QString &name);
 
 	void update_page_overlay();
 
@@ -60,9 +63,12 @@ private slots:
 	// primitive actions
 	void set_single_layout();
 	void set_grid_layout();
+	void set_continuous_layout();
 	void set_presenter_layout();
 
 	void toggle_overlay();
+	void toggle_stats();
+	void update_stats_overlay();
 	void focus_goto();
 
 	void disable_triple_click();
@@ -76,10 +82,13 @@ private:
 	Layout *cur_layout;
 	SingleLayout *single_layout;
 	GridLayout *grid_layout;
+	ContinuousLayout *continuous_layout;
 	PresenterLayout *presenter_layout;
 
 	GotoLine *goto_line;
 	QLabel *page_overlay;
+	QLabel *stats_overlay;
+	QTimer stats_timer;
 
 	int mx, my;
 	int mx_down, my_down;
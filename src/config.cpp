@@ -37,17 +37,36 @@ void CFG::init_defaults() {
 	vd.push_back("Settings/zoom_factor"); defaults[vd.back()] = 0.05;
 	vd.push_back("Settings/min_page_width"); defaults[vd.back()] = 50;
 	vd.push_back("Settings/presenter_slide_ratio"); defaults[vd.back()] = 0.67;
+	vd.push_back("Settings/presenter_prerender_count"); defaults[vd.back()] = 5;
 	// viewer
 	vd.push_back("Settings/quit_on_init_fail"); defaults[vd.back()] = false;
 	vd.push_back("Settings/single_instance_per_file"); defaults[vd.back()] = false;
 	vd.push_back("Settings/stylesheet"); defaults[vd.back()] = "";
 	vd.push_back("Settings/page_overlay_text"); defaults[vd.back()] = "Page %1/%2";
 	vd.push_back("Settings/icon_theme"); defaults[vd.back()] = "";
+	vd.push_back("Settings/stats_file"); defaults[vd.back()] = ""; // written on exit if set
+	vd.push_back("Settings/trace_file"); defaults[vd.back()] = ""; // enables tracing if set
+	vd.push_back("Settings/trace_buffer_size"); defaults[vd.back()] = 65536; // events kept per thread
 	// internal
 	vd.push_back("Settings/prefetch_count"); defaults[vd.back()] = 4;
+	vd.push_back("Settings/prefetch_lookahead"); defaults[vd.back()] = 0.5; // seconds of scrolling to prefetch ahead
+	vd.push_back("Settings/prefetch_max_count"); defaults[vd.back()] = 16;
+	vd.push_back("Settings/prefetch_idle_time"); defaults[vd.back()] = 300; // ms without input that end a motion
+	vd.push_back("Settings/prefetch_max_time"); defaults[vd.back()] = 500; // ms, slower prefetches are deferred and rendered smaller
 	vd.push_back("Settings/mouse_wheel_factor"); defaults[vd.back()] = 120; // (qt-)delta for turning the mouse wheel 1 click
+	vd.push_back("Settings/fast_render_while_scrolling"); defaults[vd.back()] = false;
+	vd.push_back("Settings/quality_render_delay"); defaults[vd.back()] = 250; // ms without input before rendering in quality again
+	vd.push_back("Settings/direct_render"); defaults[vd.back()] = false;
+	vd.push_back("Settings/direct_render_max_time"); defaults[vd.back()] = 10; // ms a page may take to be painted directly
+	vd.push_back("Settings/download_connections"); defaults[vd.back()] = 4;
+	vd.push_back("Settings/download_cache_size"); defaults[vd.back()] = 512; // MiB, 0 disables
+	vd.push_back("Settings/range_request_min_size"); defaults[vd.back()] = 32; // MiB, 0 disables
+	vd.push_back("Settings/reload_delay"); defaults[vd.back()] = 300; // ms without changes before reloading a modified file
+	vd.push_back("Settings/shared_cache_size"); defaults[vd.back()] = 0; // MiB, 0 disables
 	vd.push_back("Settings/thumbnail_filter"); defaults[vd.back()] = true; // filter when creating thumbnail image
 	vd.push_back("Settings/thumbnail_size"); defaults[vd.back()] = 32;
+	vd.push_back("Settings/overview_page_size"); defaults[vd.back()] = 100; // 0 disables the overview atlas
+	vd.push_back("Settings/overview_tile_pages"); defaults[vd.back()] = 64;
 
 	// keys
 	// movement
@@ -77,6 +96,7 @@ void CFG::init_defaults() {
 	vk.push_back("Keys/set_single_layout"); keys[vk.back()] = QStringList() << "1";
 	vk.push_back("Keys/set_grid_layout"); keys[vk.back()] = QStringList() << "2";
 	vk.push_back("Keys/set_presenter_layout"); keys[vk.back()] = QStringList() << "3";
+	vk.push_back("Keys/set_continuous_layout"); keys[vk.back()] = QStringList() << "4";
 	vk.push_back("Keys/zoom_in"); keys[vk.back()] = QStringList() << "=" << "+";
 	vk.push_back("Keys/zoom_out"); keys[vk.back()] = QStringList() << "-";
 	vk.push_back("Keys/reset_zoom"); keys[vk.back()] = QStringList() << "Z";
@@ -99,6 +119,7 @@ void CFG::init_defaults() {
 	vk.push_back("Keys/print"); keys[vk.back()] = QStringList() << "P";
 	vk.push_back("Keys/save"); keys[vk.back()] = QStringList() << "S";
 	vk.push_back("Keys/toggle_toc"); keys[vk.back()] = QStringList() << "F9";
+	vk.push_back("Keys/toggle_stats"); keys[vk.back()] = QStringList() << "F12";
 
 	// tmp values
 	tmp_values["start_page"] = 0;
@@ -0,0 +1,231 @@
+#include "control.h"
+#include "dbus.h"
+
+#include "../viewer.h"
+#include "../canvas.h"
+#include "../search.h"
+#include "../stats.h"
+#include "../resourcemanager.h"
+#include "../layout/layout.h"
+
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusError>
+#include <QTimer>
+#include <QPointF>
+
+#include <iostream>
+
+using namespace std;
+
+Control::Control(Viewer *viewer) :
+		QDBusAbstractAdaptor(viewer),
+		viewer(viewer),
+		searching(false),
+		batch_waiting(false) {
+	connect(viewer->get_search_bar(), SIGNAL(search_finished()),
+	        this, SLOT(search_finished()));
+	connect(viewer->get_search_bar(), SIGNAL(search_stopped()),
+	        this, SLOT(search_stopped()));
+	connect(viewer, SIGNAL(file_loaded(const QString &)),
+	        this, SLOT(file_loaded(const QString &)));
+}
+
+void Control::goto_page(int page) {
+	viewer->get_canvas()->get_layout()->scroll_page(page, false);
+}
+
+void Control::goto_position(int page, double x, double y) {
+	viewer->get_canvas()->get_layout()->goto_position(page, QPointF(x, y));
+}
+
+int Control::search(QString term, bool forward, const QDBusMessage &message) {
+	if (term.isEmpty() || !viewer->get_search_bar()->is_valid()) {
+		// nothing will be searched, reply right away
+		return 0;
+	}
+	message.setDelayedReply(true);
+	start_search(term, forward);
+	searches.push_back(message);
+	return 0;
+}
+
+void Control::start_search(const QString &term, bool forward) {
+	SearchBar *bar = viewer->get_search_bar();
+	// the same term again would not be searched
+	// stopping the previous search fails its callers through search_stopped
+	bar->reset_search();
+	bar->search(term, forward);
+	bar->show();
+	searching = true;
+}
+
+void Control::search_stopped() {
+	abort_search("search aborted");
+}
+
+void Control::abort_search(const QString &reason) {
+	if (!searching) {
+		return;
+	}
+	searching = false;
+	Q_FOREACH(const QDBusMessage &message, searches) {
+		QDBusConnection::sessionBus().send(message.createErrorReply(QDBusError::Failed, reason));
+	}
+	searches.clear();
+
+	if (batch_waiting) {
+		batch_waiting = false;
+		batch_replies.push_back("error: " + reason);
+		QTimer::singleShot(0, this, SLOT(run_batch()));
+	}
+}
+
+void Control::search_finished() {
+	if (!searching) {
+		return; // started by the user
+	}
+	searching = false;
+	int pages = viewer->get_search_bar()->get_hits()->size();
+	Q_FOREACH(const QDBusMessage &message, searches) {
+		QDBusConnection::sessionBus().send(message.createReply(pages));
+	}
+	searches.clear();
+
+	if (batch_waiting) {
+		batch_waiting = false;
+		batch_replies.push_back(QString::number(pages));
+		QTimer::singleShot(0, this, SLOT(run_batch()));
+	}
+}
+
+bool Control::set_layout(QString name) {
+	return viewer->get_canvas()->set_layout(name);
+}
+
+void Control::set_zoom(int zoom, bool relative) {
+	viewer->get_canvas()->get_layout()->set_zoom(zoom, relative);
+}
+
+void Control::set_columns(int columns, bool relative) {
+	viewer->get_canvas()->get_layout()->set_columns(columns, relative);
+}
+
+QList<int> Control::visible_pages() {
+	// visible pages are consecutive, around the current one
+	Layout *layout = viewer->get_canvas()->get_layout();
+	int page_count = viewer->get_res()->get_page_count();
+	int first = layout->get_page();
+	while (first > 0 && layout->page_visible(first - 1)) {
+		first--;
+	}
+	QList<int> pages;
+	for (int page = first; page < page_count && layout->page_visible(page); page++) {
+		pages.push_back(page);
+	}
+	return pages;
+}
+
+QString Control::stats() {
+	return Stats::get_instance()->report();
+}
+
+QStringList Control::batch(QStringList commands, const QDBusMessage &message) {
+	message.setDelayedReply(true);
+	batch_messages.push_back(message);
+	batch_commands.push_back(commands);
+	if (batch_messages.size() == 1) {
+		batch_replies.clear();
+		// reply after returning to the event loop
+		QTimer::singleShot(0, this, SLOT(run_batch()));
+	}
+	return QStringList();
+}
+
+void Control::run_batch() {
+	if (batch_waiting) {
+		return; // the search continues it
+	}
+	while (!batch_messages.empty()) {
+		QStringList &commands = batch_commands.front();
+		while (batch_replies.size() < commands.size()) {
+			QString command = commands[batch_replies.size()].trimmed();
+			if (command.startsWith("search ")) {
+				QString term = command.mid(7).trimmed();
+				if (term.isEmpty() || !viewer->get_search_bar()->is_valid()) {
+					// would never finish
+					batch_replies.push_back("error: nothing to search in " + command);
+					continue;
+				}
+				// continues in search_finished or abort_search
+				start_search(term, true);
+				batch_waiting = true;
+				return;
+			}
+			batch_replies.push_back(run_command(command));
+		}
+
+		QDBusConnection::sessionBus().send(batch_messages.front().createReply(batch_replies));
+		batch_messages.pop_front();
+		batch_commands.pop_front();
+		batch_replies.clear();
+	}
+}
+
+QString Control::run_command(const QString &command) {
+	QStringList args = command.split(' ', QString::SkipEmptyParts);
+	if (args.empty()) {
+		return "error: empty command";
+	}
+	QString name = args.takeFirst();
+	// +N and -N are relative
+	bool relative = !args.empty() && (args[0].startsWith('+') || args[0].startsWith('-'));
+	bool ok = true;
+
+	if (name == "page" && args.size() == 1) {
+		goto_page(args[0].toInt(&ok));
+	} else if (name == "position" && args.size() == 3) {
+		bool ok_x, ok_y;
+		goto_position(args[0].toInt(&ok), args[1].toDouble(&ok_x), args[2].toDouble(&ok_y));
+		ok = ok && ok_x && ok_y;
+	} else if (name == "layout" && args.size() == 1) {
+		ok = set_layout(args[0]);
+	} else if (name == "zoom" && args.size() == 1) {
+		set_zoom(args[0].toInt(&ok), relative);
+	} else if (name == "columns" && args.size() == 1) {
+		set_columns(args[0].toInt(&ok), relative);
+	} else if (name == "visible" && args.empty()) {
+		QStringList pages;
+		Q_FOREACH(int page, visible_pages()) {
+			pages << QString::number(page);
+		}
+		return pages.join(" ");
+	} else if (name == "stats" && args.empty()) {
+		return stats();
+	} else {
+		return "error: unknown command " + command;
+	}
+	return ok ? "ok" : "error: invalid argument in " + command;
+}
+
+void Control::file_loaded(const QString &file) {
+	register_file(file);
+}
+
+void Control::register_file(const QString &file) {
+	QString service = file.isEmpty() ? QString() : dbus_file_service(file);
+	if (service == file_service) {
+		return;
+	}
+	QDBusConnectionInterface *bus = QDBusConnection::sessionBus().interface();
+	if (!file_service.isEmpty()) {
+		bus->unregisterService(file_service);
+	}
+	file_service = service;
+	if (!file_service.isEmpty()) {
+		// a second instance of the file takes over when this one quits
+		bus->registerService(file_service, QDBusConnectionInterface::QueueService,
+				QDBusConnectionInterface::DontAllowReplacement);
+	}
+}
+
@@ -0,0 +1,91 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <QDBusAbstractAdaptor>
+#include <QDBusMessage>
+#include <QStringList>
+#include <QList>
+
+class Viewer;
+
+class Control : public QDBusAbstractAdaptor {
+	Q_OBJECT;
+	Q_CLASSINFO("D-Bus Interface", "katarakt.Control");
+
+public:
+	Control(Viewer *viewer);
+
+public slots:
+	/** Jump to a (0 indexed) page.
+	 */
+	void goto_page(int page);
+
+	/** Make the position (x,y) in points from the top left corner of
+	 * the (0 indexed) page visible.
+	 */
+	void goto_position(int page, double x, double y);
+
+	/** Search for term. The reply is delayed until all pages are
+	 * searched and contains the number of pages with hits. Fails if
+	 * the search is replaced by another one or the document reloads.
+	 */
+	int search(QString term, bool forward, const QDBusMessage &message);
+
+	/** Switch to the "single", "grid", "continuous" or "presenter"
+	 * layout, returns false for unknown names.
+	 */
+	bool set_layout(QString name);
+
+	/** Like the zoom and column keys if relative is true.
+	 */
+	void set_zoom(int zoom, bool relative);
+	void set_columns(int columns, bool relative);
+
+	/** The (0 indexed) pages currently on the screen.
+	 */
+	QList<int> visible_pages();
+
+	/** Same as katarakt.Stats.report
+	 */
+	QString stats();
+
+	/** Runs several commands in one call and replies with one line per
+	 * command once all are done, see the manpage for the commands.
+	 * A search command waits for the search to finish.
+	 */
+	QStringList batch(QStringList commands, const QDBusMessage &message);
+
+public:
+	/** Makes the file's service name point to this instance,
+	 * see dbus_file_service. Not exported, only the instance itself
+	 * decides which file it shows.
+	 */
+	void register_file(const QString &file);
+
+private slots:
+	void search_finished();
+	void search_stopped();
+	void run_batch();
+	void file_loaded(const QString &file);
+
+private:
+	QString run_command(const QString &command);
+	void start_search(const QString &term, bool forward);
+	// fails the waiting callers of a search that won't finish
+	void abort_search(const QString &reason);
+
+	Viewer *viewer;
+	QString file_service; // registered name for the current file
+
+	QList<QDBusMessage> searches; // waiting for search_finished
+	bool searching;
+
+	// one batch at a time, the others wait
+	QList<QDBusMessage> batch_messages;
+	QList<QStringList> batch_commands;
+	QStringList batch_replies;
+	bool batch_waiting; // for a search to finish
+};
+
+#endif /* CONTROL_H */
+
@@ -1,14 +1,17 @@
 #include "dbus.h"
 #include "source_correlate.h"
+#include "stats_export.h"
+#include "control.h"
 #include "../viewer.h"
+#include "../resourcemanager.h"
 
 #include <QDBusConnection>
 #include <QApplication>
 #include <QDBusConnectionInterface>
 #include <QDBusInterface>
-#include <QRegExp>
+#include <QDBusReply>
+#include <QCryptographicHash>
 #include <QString>
-#include <QStringList>
 #include <QFileInfo>
 
 
@@ -21,9 +24,12 @@ void dbus_init(Viewer *viewer) {
 	 *
 	 * These are automatically destroyed, if the parent object is.
 	 *
-	 * At present, there is only the SourceCorrelate interface.
+	 * SourceCorrelate talks to editors, StatsExport reports runtime statistics,
+	 * Control remote controls the viewer.
 	 */
 	new SourceCorrelate(viewer);
+	new StatsExport(viewer);
+	Control *control = new Control(viewer);
 
 	QString bus_name = QString("katarakt.pid%1").arg(QApplication::applicationPid());
 
@@ -36,6 +42,9 @@ void dbus_init(Viewer *viewer) {
 #ifdef DEBUG
 			cerr << "Failed to register viewer object on DBus" << endl;
 #endif
+		} else {
+			// only claim the file once the object can be called
+			control->register_file(viewer->get_res()->get_file());
 		}
 	}
 }
@@ -46,19 +55,19 @@ bool activate_katarakt_with_file(QString file) {
 		return false;
 	}
 
-	QString filepath = QFileInfo(file).absoluteFilePath();
+	// one lookup instead of asking every instance for its file
+	QString service = dbus_file_service(file);
 	QDBusConnection bus = QDBusConnection::sessionBus();
-	QStringList services = bus.interface()->registeredServiceNames().value();
-	QStringList katarakts = services.filter(QRegExp("^katarakt\\.pid"));
-	foreach (const QString& katarakt_service, katarakts) {
-		QDBusInterface dbus_iface(katarakt_service, "/", "katarakt.SourceCorrelate", bus);
-		QDBusReply<QString> reply = dbus_iface.call("filepath");
-		if (reply.isValid()) {
-			if (reply.value() == filepath) {
-				dbus_iface.call("focus");
-				return true;
-			}
-		}
+	if (!bus.interface()->isServiceRegistered(service)) {
+		return false;
 	}
-	return false;
+	QDBusInterface dbus_iface(service, "/", "katarakt.SourceCorrelate", bus);
+	QDBusReply<void> reply = dbus_iface.call("focus");
+	return reply.isValid();
+}
+
+QString dbus_file_service(const QString &file) {
+	QByteArray path = QFileInfo(file).absoluteFilePath().toUtf8();
+	// name elements must not start with a digit
+	return QString("katarakt.file.h") + QCryptographicHash::hash(path, QCryptographicHash::Sha1).toHex();
 }
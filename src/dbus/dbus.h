@@ -20,4 +20,10 @@ void dbus_init(Viewer *viewer);
  */
 bool activate_katarakt_with_file(QString file);
 
+/**
+ * The service name an instance showing file registers in addition to
+ * katarakt.pid<PID>, so it can be found without asking every instance.
+ */
+QString dbus_file_service(const QString &file);
+
 #endif /* DBUS_H */
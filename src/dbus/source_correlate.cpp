@@ -4,6 +4,7 @@
 #include "../canvas.h"
 #include "../layout/layout.h"
 #include "../resourcemanager.h"
+#include "../synctex.h"
 
 #include <QUrl>
 #include <QFileInfo>
@@ -33,12 +34,28 @@ void SourceCorrelate::view(QString filename, int page, double x, double y) {
 	viewer->get_canvas()->get_layout()->goto_position(page, QPointF(x, y));
 }
 
+bool SourceCorrelate::view_source(QString source, int line, int /*column*/) {
+	int page;
+	QRectF rect;
+	if (!viewer->get_synctex()->find_output(source, line, page, rect)) {
+		return false;
+	}
+	viewer->get_canvas()->get_layout()->goto_position(page, rect.topLeft());
+	return true;
+}
+
 void SourceCorrelate::emit_edit_signal(int page, int x, int y) {
 	QString file = viewer->get_res()->get_file();
 #ifdef DEBUG
 	qDebug("Emitting the edit signal");
 #endif
 	emit edit(file, page, x, y);
+
+	QString source;
+	int line, column;
+	if (viewer->get_synctex()->find_source(page, QPointF(x, y), source, line, column)) {
+		emit edit_source(source, line, column);
+	}
 }
 
 void SourceCorrelate::focus() {
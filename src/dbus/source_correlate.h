@@ -21,6 +21,13 @@ public slots:
 	 */
 	void view(QString filename, int page, double x, double y);
 
+	/** Jump to the output of line in the source file, using the
+	 * .synctex.gz next to the document. The column is not used yet.
+	 *
+	 * Returns false if the synctex data doesn't know the line.
+	 */
+	bool view_source(QString source, int line, int column);
+
 	/** Lets the katarakt window ask the window manager for the focus
 	 */
 	void focus();
@@ -37,6 +44,11 @@ signals:
 	 */
 	void edit(QString filename, int page, int x, int y);
 
+	/** Emitted after edit, if the synctex data knows the source of the
+	 * position. The line is 1-indexed, the column is -1 if unknown.
+	 */
+	void edit_source(QString source, int line, int column);
+
 private slots:
 	void emit_edit_signal(int page, int x, int y);
 
@@ -0,0 +1,15 @@
+#include "stats_export.h"
+
+#include "../viewer.h"
+#include "../stats.h"
+
+using namespace std;
+
+StatsExport::StatsExport(Viewer *viewer) :
+		QDBusAbstractAdaptor(viewer) {
+}
+
+QString StatsExport::report() {
+	return Stats::get_instance()->report();
+}
+
@@ -0,0 +1,23 @@
+#ifndef STATS_EXPORT_H
+#define STATS_EXPORT_H
+
+#include <QDBusAbstractAdaptor>
+
+class Viewer;
+
+class StatsExport : public QDBusAbstractAdaptor {
+	Q_OBJECT;
+	Q_CLASSINFO("D-Bus Interface", "katarakt.Stats");
+
+public:
+	StatsExport(Viewer *viewer);
+
+public slots:
+	/** Render, paint and queue histograms, cache hit rate, image memory
+	 * and search speed, one line each
+	 */
+	QString report();
+};
+
+#endif /* STATS_EXPORT_H */
+
@@ -0,0 +1,65 @@
+#include "documentloader.h"
+#include "documentpool.h"
+
+using namespace std;
+
+
+DocumentLoader::DocumentLoader(const QString &file, const QByteArray &password) :
+		file(file),
+		password(password),
+		pool(NULL),
+		valid(false) {
+}
+
+DocumentLoader::~DocumentLoader() {
+	wait();
+	if (pool != NULL) {
+		pool->deref();
+	}
+}
+
+void DocumentLoader::load() {
+	pool = new DocumentPool(file, password);
+	Poppler::Document *doc = pool->acquire();
+	if (doc == NULL || doc->isLocked() || doc->numPages() <= 0) {
+		pool->release(doc);
+		return;
+	}
+
+	// a truncated file often parses, but its pages don't
+	page_sizes.resize(doc->numPages());
+	for (int i = 0; i < doc->numPages(); i++) {
+		Poppler::Page *p = doc->page(i);
+		if (p == NULL) {
+			pool->release(doc);
+			return;
+		}
+		page_sizes[i] = p->pageSizeF();
+		delete p;
+	}
+	// the first user gets this one without parsing again
+	pool->release(doc);
+	valid = true;
+}
+
+bool DocumentLoader::is_valid() const {
+	return valid;
+}
+
+const QString &DocumentLoader::get_file() const {
+	return file;
+}
+
+DocumentPool *DocumentLoader::take_pool() {
+	if (!valid) {
+		return NULL;
+	}
+	DocumentPool *p = pool;
+	pool = NULL;
+	return p;
+}
+
+const QVector<QSizeF> &DocumentLoader::get_page_sizes() const {
+	return page_sizes;
+}
+
@@ -0,0 +1,42 @@
+#ifndef DOCUMENTLOADER_H
+#define DOCUMENTLOADER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QSizeF>
+#include "loaderthread.h"
+
+
+class DocumentPool;
+
+
+// parses a document and its page sizes without blocking the gui
+class DocumentLoader : public LoaderThread {
+	Q_OBJECT
+
+public:
+	DocumentLoader(const QString &file, const QByteArray &password);
+	~DocumentLoader();
+
+	// all pages could be read, only valid after the thread finished
+	bool is_valid() const;
+	const QString &get_file() const;
+	// hands over the pool with the parsed document, NULL if invalid or already taken
+	DocumentPool *take_pool();
+	const QVector<QSizeF> &get_page_sizes() const;
+
+protected:
+	void load();
+
+private:
+	QString file;
+	QByteArray password;
+
+	DocumentPool *pool;
+	QVector<QSizeF> page_sizes;
+	bool valid;
+};
+
+#endif
+
@@ -0,0 +1,63 @@
+#include "documentpool.h"
+#include "resourcemanager.h"
+
+using namespace std;
+
+
+DocumentPool::DocumentPool(const QString &file, const QByteArray &password) :
+		file(file),
+		password(password),
+		refs(1) {
+}
+
+DocumentPool::~DocumentPool() {
+	for (list<Poppler::Document *>::iterator it = idle.begin(); it != idle.end(); ++it) {
+		delete *it;
+	}
+}
+
+void DocumentPool::ref() {
+	refs.ref();
+}
+
+void DocumentPool::deref() {
+	if (!refs.deref()) {
+		delete this;
+	}
+}
+
+Poppler::Document *DocumentPool::acquire() {
+	Poppler::Document *doc = NULL;
+	mutex.lock();
+	if (!idle.empty()) {
+		doc = idle.front();
+		idle.pop_front();
+	}
+	mutex.unlock();
+
+	if (doc == NULL) {
+		// parse outside the lock, other threads may take idle documents meanwhile
+		doc = Poppler::Document::load(file, QByteArray(), password);
+		if (doc == NULL) {
+			return NULL;
+		}
+		reset(doc);
+	}
+	return doc;
+}
+
+void DocumentPool::release(Poppler::Document *doc) {
+	if (doc == NULL) {
+		return;
+	}
+	reset(doc);
+	mutex.lock();
+	idle.push_back(doc);
+	mutex.unlock();
+}
+
+void DocumentPool::reset(Poppler::Document *doc) {
+	doc->setRenderBackend(Poppler::Document::SplashBackend);
+	ResourceManager::apply_render_hints(doc, false);
+}
+
@@ -0,0 +1,48 @@
+#ifndef DOCUMENTPOOL_H
+#define DOCUMENTPOOL_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMutex>
+#include <QAtomicInt>
+#include <poppler/qt4/poppler-qt4.h>
+#include <list>
+
+
+// all documents of one file
+// poppler documents can't be shared between threads, so every busy thread
+// gets its own; returned documents are reused instead of parsing again
+// documents are opened from the file, loadFromData would give every one of
+// them a private copy of the whole file
+class DocumentPool {
+public:
+	DocumentPool(const QString &file, const QByteArray &password);
+
+	// every holder keeps a reference, the last one deletes the pool
+	// documents can be returned after a reload that way
+	void ref();
+	void deref();
+
+	// an idle document or a new one, also if locked; NULL if it can't be opened
+	// render backend and hints are at the defaults
+	Poppler::Document *acquire();
+	// resets what the holder changed, e.g. the direct painting's Arthur backend
+	void release(Poppler::Document *doc);
+
+private:
+	static void reset(Poppler::Document *doc);
+
+	DocumentPool(const DocumentPool &other);
+	DocumentPool &operator=(const DocumentPool &other);
+	~DocumentPool();
+
+	QString file;
+	QByteArray password;
+
+	QAtomicInt refs;
+	QMutex mutex;
+	std::list<Poppler::Document *> idle;
+};
+
+#endif
+
@@ -7,54 +7,85 @@
 #include <QByteArray>
 #include <QDir>
 #include <QFileInfo>
+#include <QRegExp>
 
 using namespace std;
 
 
 Download::Download() :
 	manager(new QNetworkAccessManager()),
-	file(NULL) {
+	reply(NULL),
+	file(NULL),
+	not_modified(false),
+	written(0),
+	first_page_end(-1),
+	linearization_checked(false),
+	complete(false) {
 }
 
 Download::~Download() {
+	if (reply != NULL) {
+		reply->abort();
+		delete reply;
+	}
 	delete manager;
 	delete file;
 }
 
 QString Download::load(QString f) {
-	QUrl url(f);
+	url = QUrl(f);
 	if (url.isLocalFile() || url.isRelative()) {
 		// found local file, do not download
 		return QDir::toNativeSeparators(url.toLocalFile());
 	}
 
-	QEventLoop loop;
-	QObject::connect(manager, SIGNAL(finished(QNetworkReply *)), &loop, SLOT(quit()));
-	QNetworkReply *reply = manager->get(QNetworkRequest(url));
-	QObject::connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(progress(qint64, qint64)));
-	loop.exec();
-#ifdef DEBUG
-	cerr << "File downloaded" << endl;
-#endif
-
 	// find unique temporary filename
 	QFileInfo fileInfo(url.path());
 	QString fileName = fileInfo.fileName();
 	delete file;
 	file = new QTemporaryFile(QDir::tempPath() + QDir::separator() + fileName);
 	file->setAutoRemove(true);
-	file->open();
-
-	if (reply->error() != QNetworkReply::NoError || !reply->isReadable()) {
-		cerr << reply->errorString().toStdString() << endl;
+	if (!file->open()) {
+		cerr << "failed to create temporary file" << endl;
 		return QString();
 	}
+	written = 0;
+	first_page_end = -1;
+	linearization_checked = false;
+	complete = false;
+	not_modified = false;
+	stored = QString();
 
-	// store data in tempfile
-	QByteArray data = reply->readAll();
-	reply->deleteLater();
-	file->write(data);
-	file->close();
+	// data goes straight to the file as it arrives
+	QEventLoop loop;
+	QNetworkRequest request(url);
+	cached = cache.prepare(url, request);
+	reply = manager->get(request);
+	QObject::connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(progress(qint64, qint64)));
+	QObject::connect(reply, SIGNAL(readyRead()), this, SLOT(write_data()));
+	QObject::connect(reply, SIGNAL(finished()), this, SLOT(finished()));
+	QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+	QObject::connect(this, SIGNAL(first_page_available()), &loop, SLOT(quit()));
+	loop.exec();
+
+	if (!complete) {
+#ifdef DEBUG
+		cerr << "showing first page, downloading the rest" << endl;
+#endif
+		return file->fileName();
+	}
+#ifdef DEBUG
+	cerr << "File downloaded" << endl;
+#endif
+	if (not_modified) {
+		return cached;
+	}
+	if (written == 0) {
+		return QString();
+	}
+	if (!stored.isEmpty()) {
+		return stored;
+	}
 #ifdef DEBUG
 	cerr << "filename: " << file->fileName().toStdString() << endl;
 #endif
@@ -67,3 +98,73 @@ void Download::progress(qint64 bytes_received, qint64 bytes_total) {
 	cout << (bytes_total / 1024.0f) << "KB downloaded\r";
 }
 
+void Download::write_data() {
+	QByteArray data = reply->readAll();
+	if (file->write(data) != data.size()) {
+		cerr << "failed to write " << file->fileName().toStdString() << endl;
+		reply->abort();
+		return;
+	}
+	written += data.size();
+
+	if (!linearization_checked && written >= 1024) {
+		check_linearized();
+	}
+	// everything the first page needs is there
+	if (first_page_end > 0 && written >= first_page_end) {
+		file->flush();
+		first_page_end = -1;
+		emit first_page_available();
+	}
+}
+
+void Download::finished() {
+	int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+	if (reply->error() != QNetworkReply::NoError) {
+		cerr << reply->errorString().toStdString() << endl;
+		written = 0;
+	} else if (status == 304 && !cached.isEmpty()) {
+		not_modified = true;
+	} else {
+		write_data();
+		file->flush();
+		stored = cache.store(url, file->fileName(), reply);
+	}
+	complete = true;
+	reply->deleteLater();
+	reply = NULL;
+	// closing a written file makes the viewer reload it
+	file->close();
+}
+
+void Download::check_linearized() {
+	linearization_checked = true;
+
+	// the linearization dictionary has to be the first object in the file
+	file->flush();
+	QFile head(file->fileName());
+	if (!head.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	QString dict = QString::fromLatin1(head.read(1024));
+	head.close();
+	if (dict.indexOf("/Linearized") == -1) {
+		return;
+	}
+	QRegExp length("/L\\s+(\\d+)");
+	QRegExp end("/E\\s+(\\d+)");
+	if (length.indexIn(dict) == -1 || end.indexIn(dict) == -1) {
+		return;
+	}
+
+	// incremental updates invalidate the linearization
+	QVariant size = reply->header(QNetworkRequest::ContentLengthHeader);
+	if (size.isValid() && size.toLongLong() != length.cap(1).toLongLong()) {
+		return;
+	}
+	first_page_end = end.cap(1).toLongLong();
+#ifdef DEBUG
+	cerr << "linearized, first page ends at " << first_page_end << endl;
+#endif
+}
+
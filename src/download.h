@@ -4,6 +4,11 @@
 #include <QString>
 #include <QNetworkAccessManager>
 #include <QTemporaryFile>
+#include <QUrl>
+#include "downloadmanager.h"
+
+
+class QNetworkReply;
 
 
 class Download : public QObject {
@@ -13,14 +18,35 @@ public:
 	Download();
 	~Download();
 
+	// returns as soon as the document can be shown, which is before the
+	// download is complete for linearized documents
+	// the file is closed when it is complete, which triggers a reload
 	QString load(QString);
 
+signals:
+	void first_page_available();
+
 private slots:
 	void progress(qint64 bytes_received, qint64 bytes_total);
+	void write_data();
+	void finished();
 
 private:
+	void check_linearized();
+
 	QNetworkAccessManager *manager;
+	QNetworkReply *reply;
 	QTemporaryFile *file;
+	DownloadCache cache;
+	QUrl url;
+	QString cached; // revalidated copy, if any
+	QString stored; // cached copy of this download
+	bool not_modified;
+
+	qint64 written;
+	qint64 first_page_end; // -1 if unknown or not linearized
+	bool linearization_checked;
+	bool complete;
 };
 
 #endif
@@ -0,0 +1,290 @@
+#include "downloadmanager.h"
+#include "config.h"
+#include <iostream>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QTemporaryFile>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTextStream>
+#include <sys/time.h>
+
+using namespace std;
+
+
+//==[ DownloadCache ]==========================================================
+DownloadCache::DownloadCache() {
+	CFG *config = CFG::get_instance();
+	max_size = config->get_value("Settings/download_cache_size").toLongLong() * 1024 * 1024;
+	if (max_size <= 0) {
+		return;
+	}
+
+	QString base = QString::fromLocal8Bit(qgetenv("XDG_CACHE_HOME"));
+	if (base.isEmpty()) {
+		base = QDir::homePath() + "/.cache";
+	}
+	QDir d(base + "/katarakt/downloads");
+	if (!d.mkpath("urls")) {
+		cerr << "failed to create " << d.path().toUtf8().constData() << endl;
+		return;
+	}
+	dir = d.path();
+}
+
+bool DownloadCache::is_enabled() const {
+	return !dir.isEmpty();
+}
+
+QString DownloadCache::prepare(const QUrl &url, QNetworkRequest &request) {
+	if (!is_enabled()) {
+		return QString();
+	}
+	// content hash, etag, last modified
+	QFile index(get_index_file(url));
+	if (!index.open(QIODevice::ReadOnly)) {
+		return QString();
+	}
+	QList<QByteArray> lines = index.readAll().split('\n');
+	index.close();
+	if (lines.size() < 3) {
+		return QString();
+	}
+	QString file = dir + "/" + QString::fromLatin1(lines[0]) + ".pdf";
+	if (!QFile::exists(file)) {
+		return QString();
+	}
+	if (!lines[1].isEmpty()) {
+		request.setRawHeader("If-None-Match", lines[1]);
+	}
+	if (!lines[2].isEmpty()) {
+		request.setRawHeader("If-Modified-Since", lines[2]);
+	}
+	// returned as is if not modified
+	use(file);
+	return file;
+}
+
+QString DownloadCache::store(const QUrl &url, const QString &file, QNetworkReply *reply) {
+	if (!is_enabled()) {
+		return QString();
+	}
+	QFile f(file);
+	if (!f.open(QIODevice::ReadOnly)) {
+		return QString();
+	}
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	while (!f.atEnd()) {
+		hash.addData(f.read(1024 * 1024));
+	}
+	f.close();
+	QString content = QString::fromLatin1(hash.result().toHex());
+
+	// the same content from different urls is stored once
+	QString cached = dir + "/" + content + ".pdf";
+	if (!QFile::exists(cached) && !QFile::copy(file, cached)) {
+		cerr << "failed to write " << cached.toUtf8().constData() << endl;
+		return QString();
+	}
+	use(cached);
+
+	QFile index(get_index_file(url));
+	if (index.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		index.write(content.toLatin1() + "\n");
+		index.write(reply->rawHeader("ETag") + "\n");
+		index.write(reply->rawHeader("Last-Modified") + "\n");
+		index.close();
+	}
+	prune();
+	return cached;
+}
+
+QString DownloadCache::get_index_file(const QUrl &url) const {
+	return dir + "/urls/" + QString::fromLatin1(
+			QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex());
+}
+
+void DownloadCache::use(const QString &file) {
+	// a reused copy would otherwise look as old as its first download
+	utimes(QFile::encodeName(file).constData(), NULL);
+	in_use.insert(file);
+}
+
+void DownloadCache::prune() {
+	// drop the least recently used documents
+	QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "*.pdf",
+			QDir::Files, QDir::Time | QDir::Reversed);
+	qint64 size = 0;
+	Q_FOREACH(const QFileInfo &info, files) {
+		size += info.size();
+	}
+	for (int i = 0; i < files.size() && size > max_size; i++) {
+		// other documents of this run are about to be opened
+		if (in_use.contains(files[i].filePath())) {
+			continue;
+		}
+		size -= files[i].size();
+		QFile::remove(files[i].filePath());
+	}
+	// index entries of removed files are ignored by prepare
+}
+
+
+//==[ DownloadManager ]========================================================
+DownloadManager::Job::Job() :
+		reply(NULL),
+		file(NULL),
+		received(0),
+		total(0) {
+}
+
+DownloadManager::Job::~Job() {
+	delete reply;
+	delete file;
+}
+
+DownloadManager::DownloadManager() :
+		next_job(0),
+		running(0),
+		done(0) {
+	max_connections = CFG::get_instance()->get_value("Settings/download_connections").toInt();
+	if (max_connections < 1) {
+		max_connections = 1;
+	}
+}
+
+DownloadManager::~DownloadManager() {
+	Q_FOREACH(Job *job, jobs) {
+		delete job;
+	}
+}
+
+QStringList DownloadManager::load(const QStringList &urls) {
+	Q_FOREACH(Job *job, jobs) {
+		delete job;
+	}
+	jobs.clear();
+	replies.clear();
+	next_job = running = done = 0;
+
+	Q_FOREACH(const QString &u, urls) {
+		Job *job = new Job();
+		job->url = QUrl(u);
+		jobs.push_back(job);
+	}
+	while (running < max_connections && next_job < jobs.size()) {
+		start_next();
+	}
+	if (done < jobs.size()) {
+		loop.exec();
+	}
+	cout << endl;
+
+	QStringList result;
+	Q_FOREACH(Job *job, jobs) {
+		result << job->result;
+	}
+	return result;
+}
+
+void DownloadManager::start_next() {
+	Job *job = jobs[next_job++];
+	if (job->url.isLocalFile() || job->url.isRelative()) {
+		job->result = QDir::toNativeSeparators(job->url.toLocalFile());
+		done++;
+		return;
+	}
+
+	// streamed to a temporary file, copied into the cache when complete
+	job->file = new QTemporaryFile(QDir::tempPath() + QDir::separator() + "katarakt");
+	if (!job->file->open()) {
+		cerr << "failed to create temporary file" << endl;
+		done++;
+		return;
+	}
+
+	QNetworkRequest request(job->url);
+	job->cached = cache.prepare(job->url, request);
+	job->reply = manager.get(request);
+	replies[job->reply] = job;
+	connect(job->reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(progress(qint64, qint64)));
+	connect(job->reply, SIGNAL(readyRead()), this, SLOT(write_data()));
+	connect(job->reply, SIGNAL(finished()), this, SLOT(finished()));
+	running++;
+}
+
+void DownloadManager::progress(qint64 bytes_received, qint64 bytes_total) {
+	map<QNetworkReply *,Job *>::iterator it = replies.find(static_cast<QNetworkReply *>(sender()));
+	if (it == replies.end()) {
+		return;
+	}
+	it->second->received = bytes_received;
+	it->second->total = bytes_total;
+	print_progress();
+}
+
+void DownloadManager::write_data() {
+	map<QNetworkReply *,Job *>::iterator it = replies.find(static_cast<QNetworkReply *>(sender()));
+	if (it == replies.end()) {
+		return;
+	}
+	Job *job = it->second;
+	// the body of a 304 is empty anyway
+	QByteArray data = job->reply->readAll();
+	if (job->file->write(data) != data.size()) {
+		cerr << "failed to write " << job->file->fileName().toStdString() << endl;
+		job->reply->abort();
+	}
+}
+
+void DownloadManager::finished() {
+	map<QNetworkReply *,Job *>::iterator it = replies.find(static_cast<QNetworkReply *>(sender()));
+	if (it == replies.end()) {
+		return;
+	}
+	Job *job = it->second;
+	replies.erase(it);
+	QNetworkReply *reply = job->reply;
+	job->reply = NULL;
+
+	int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+	if (reply->error() != QNetworkReply::NoError) {
+		cerr << endl << job->url.toString().toStdString() << ": "
+			<< reply->errorString().toStdString() << endl;
+	} else if (status == 304 && !job->cached.isEmpty()) {
+		job->result = job->cached; // not modified
+	} else {
+		QByteArray data = reply->readAll();
+		job->file->write(data);
+		job->file->flush();
+		job->result = cache.store(job->url, job->file->fileName(), reply);
+	}
+	reply->deleteLater();
+	delete job->file;
+	job->file = NULL;
+
+	running--;
+	done++;
+	while (running < max_connections && next_job < jobs.size()) {
+		start_next();
+	}
+	print_progress();
+	if (done == jobs.size()) {
+		loop.quit();
+	}
+}
+
+void DownloadManager::print_progress() const {
+	qint64 received = 0, total = 0;
+	Q_FOREACH(Job *job, jobs) {
+		received += job->received;
+		total += job->total > 0 ? job->total : 0;
+	}
+	cout.precision(1);
+	cout << done << "/" << jobs.size() << " files, " << fixed << (received / 1024.0f) << "/";
+	cout << (total / 1024.0f) << "KB downloaded\r" << flush;
+}
+
@@ -0,0 +1,94 @@
+#ifndef DOWNLOADMANAGER_H
+#define DOWNLOADMANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QByteArray>
+#include <QList>
+#include <QSet>
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <map>
+
+
+class QNetworkReply;
+class QNetworkRequest;
+class QTemporaryFile;
+
+
+// downloaded documents, stored by the hash of their content
+// an index maps urls to contents and keeps what is needed to revalidate them
+class DownloadCache {
+public:
+	DownloadCache();
+
+	bool is_enabled() const;
+
+	// adds conditional headers if url is cached, returns the cached file or a null string
+	QString prepare(const QUrl &url, QNetworkRequest &request);
+	// copies the downloaded file into the cache, returns the cached path
+	QString store(const QUrl &url, const QString &file, QNetworkReply *reply);
+
+private:
+	QString get_index_file(const QUrl &url) const;
+	// marks a file as recently used and keeps it for the rest of this run
+	void use(const QString &file);
+	void prune();
+
+	QString dir;
+	qint64 max_size;
+	QSet<QString> in_use; // handed out by this run, never pruned
+};
+
+
+// downloads several urls at once, sharing connections
+class DownloadManager : public QObject {
+	Q_OBJECT
+
+public:
+	DownloadManager();
+	~DownloadManager();
+
+	// blocks until all are done, returns the local files in the same order
+	// failed downloads are null strings
+	QStringList load(const QStringList &urls);
+
+private slots:
+	void progress(qint64 bytes_received, qint64 bytes_total);
+	void write_data();
+	void finished();
+
+private:
+	class Job {
+	public:
+		Job();
+		~Job();
+
+		QUrl url;
+		QNetworkReply *reply;
+		QTemporaryFile *file;
+		QString cached;
+		QString result;
+		qint64 received;
+		qint64 total;
+	};
+
+	void start_next();
+	void print_progress() const;
+
+	QNetworkAccessManager manager;
+	DownloadCache cache;
+	QList<Job *> jobs;
+	std::map<QNetworkReply *,Job *> replies;
+	QEventLoop loop;
+	int next_job;
+	int running;
+	int done;
+
+	int max_connections;
+};
+
+#endif
+
@@ -1,6 +1,7 @@
 #include "grid.h"
 #include "resourcemanager.h"
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
@@ -8,29 +9,50 @@ using namespace std;
 Grid::Grid(ResourceManager *_res, int columns, int offset) :
 		res(_res),
 		column_count(-1),
-		width(NULL), height(NULL),
+		row_count(0),
 		page_offset(offset) {
+	load_page_sizes();
 	set_columns(columns);
 }
 
 Grid::~Grid() {
-	delete[] width;
-	delete[] height;
+}
+
+void Grid::update() {
+	if (generation != res->get_generation()) {
+		// page count and sizes may have changed
+		load_page_sizes();
+		int columns = column_count;
+		column_count = -1;
+		set_columns(columns);
+	} else if (rotated != (res->get_rotation() % 2 == 1)) {
+		// widths and heights just swap
+		rotated = !rotated;
+		rebuild_positions();
+	}
 }
 
 bool Grid::set_columns(int columns) {
 	int old_column_count = column_count;
 	column_count = columns;
-	if (column_count > res->get_page_count()) {
-		column_count = res->get_page_count();
+	if (column_count > page_count) {
+		column_count = page_count;
 	}
 	if (column_count < 1) {
 		column_count = 1;
 	}
+	if (old_column_count == column_count) {
+		return false;
+	}
 
-	set_offset(page_offset);
-
-	return old_column_count != column_count;
+	if (page_offset > column_count - 1) {
+		page_offset = column_count - 1;
+	}
+	if (page_offset < 0) {
+		page_offset = 0;
+	}
+	rebuild_cells();
+	return true;
 }
 
 bool Grid::set_offset(int offset) {
@@ -42,9 +64,12 @@ bool Grid::set_offset(int offset) {
 	if (page_offset > column_count - 1) {
 		page_offset = column_count - 1;
 	}
+	if (old_page_offset == page_offset) {
+		return false;
+	}
 
 	rebuild_cells();
-	return old_page_offset != page_offset;
+	return true;
 }
 
 float Grid::get_width(int col) const {
@@ -53,7 +78,7 @@ float Grid::get_width(int col) const {
 		return -1;
 	}
 
-	return width[col];
+	return rotated ? column_height[col] : column_width[col];
 }
 
 float Grid::get_height(int row) const {
@@ -62,7 +87,27 @@ float Grid::get_height(int row) const {
 		return -1;
 	}
 
-	return height[row];
+	return rotated ? row_width[row] : row_height[row];
+}
+
+double Grid::get_column_position(int col) const {
+	if (col < 0) {
+		return 0;
+	}
+	if (col > column_count) {
+		col = column_count;
+	}
+	return column_position[col];
+}
+
+double Grid::get_row_position(int row) const {
+	if (row < 0) {
+		return 0;
+	}
+	if (row > row_count) {
+		row = row_count;
+	}
+	return row_position[row];
 }
 
 int Grid::get_column_count() const {
@@ -77,38 +122,72 @@ int Grid::get_offset() const {
 	return page_offset;
 }
 
-void Grid::rebuild_cells() {
-	delete[] width;
-	delete[] height;
+void Grid::load_page_sizes() {
+	generation = res->get_generation();
+	rotated = (res->get_rotation() % 2 == 1);
 
+	page_count = res->get_page_count();
+	page_width.resize(page_count);
+	page_height.resize(page_count);
+	for (int i = 0; i < page_count; i++) {
+		page_width[i] = res->get_page_width(i, false);
+		page_height[i] = res->get_page_height(i, false);
+	}
+}
+
+// changing the column count or offset moves every page to another cell,
+// so all column and row maxima and both prefix sums are rebuilt (O(n))
+void Grid::rebuild_cells() {
 	// implicit ceil
-	row_count = (res->get_page_count() + column_count - 1 + page_offset) / column_count;
+	row_count = (page_count + column_count - 1 + page_offset) / column_count;
+
+	// resizing keeps the allocation when shrinking
+	column_width.assign(column_count, 0.0f);
+	column_height.assign(column_count, 0.0f);
+	row_width.resize(row_count);
+	row_height.resize(row_count);
+
+	// every row is a contiguous run of pages; keep the inner loop free of
+	// index arithmetic and branches so the compiler can vectorise it
+	for (int row = 0; row < row_count; row++) {
+		int first = row * column_count - page_offset;
+		int col = 0;
+		if (first < 0) { // first row starts at page_offset
+			col = -first;
+			first = 0;
+		}
+		int n = min(column_count - col, page_count - first);
+
+		const float *pw = &page_width[first];
+		const float *ph = &page_height[first];
+		float *cw = &column_width[col];
+		float *ch = &column_height[col];
+		float rw = 0.0f;
+		float rh = 0.0f;
+		for (int i = 0; i < n; i++) {
+			cw[i] = cw[i] < pw[i] ? pw[i] : cw[i];
+			ch[i] = ch[i] < ph[i] ? ph[i] : ch[i];
+			rw = rw < pw[i] ? pw[i] : rw;
+			rh = rh < ph[i] ? ph[i] : rh;
+		}
+		row_width[row] = rw;
+		row_height[row] = rh;
+	}
 
-	width = new float[column_count];
-	height = new float[row_count];
+	rebuild_positions();
+}
 
+void Grid::rebuild_positions() {
+	// prefix sums for random access by position
+	column_position.resize(column_count + 1);
+	column_position[0] = 0.0;
 	for (int i = 0; i < column_count; i++) {
-		width[i] = -1.0f;
+		column_position[i + 1] = column_position[i] + get_width(i);
 	}
+	row_position.resize(row_count + 1);
+	row_position[0] = 0.0;
 	for (int i = 0; i < row_count; i++) {
-		height[i] = -1.0f;
-	}
-
-	for (int i = 0; i < res->get_page_count(); i++) {
-		int col = ((i + page_offset) % column_count);
-		int row = ((i + page_offset) / column_count);
-
-		// calculate column width
-		float new_width = res->get_page_width(i);
-		if (width[col] < 0 || width[col] < new_width) {
-			width[col] = new_width;
-		}
-
-		// calculate row height
-		float new_height = res->get_page_height(i);
-		if (height[row] < 0 || height[row] < new_height) {
-			height[row] = new_height;
-		}
+		row_position[i + 1] = row_position[i] + get_height(i);
 	}
 }
 
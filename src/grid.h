@@ -1,6 +1,8 @@
 #ifndef GRID_H
 #define GRID_H
 
+#include <vector>
+
 
 class ResourceManager;
 
@@ -10,24 +12,46 @@ public:
 	Grid(ResourceManager *_res, int columns, int offset);
 	~Grid();
 
+	// picks up document reloads and rotation changes
+	void update();
+
 	bool set_columns(int columns);
 	bool set_offset(int offset);
 
 	float get_width(int col) const;
 	float get_height(int row) const;
+	// summed width/height of all columns left of col/rows above row
+	double get_column_position(int col) const;
+	double get_row_position(int row) const;
 	int get_column_count() const;
 	int get_row_count() const;
 	int get_offset() const;
 
 private:
+	void load_page_sizes();
 	void rebuild_cells();
+	void rebuild_positions();
 
 	ResourceManager *res;
+	int generation;
+	bool rotated;
+
+	// unrotated page sizes, cached contiguously
+	int page_count;
+	std::vector<float> page_width;
+	std::vector<float> page_height;
 
 	int column_count;
 	int row_count;
-	float *width;
-	float *height;
+	// unrotated maxima, rotation only swaps them
+	std::vector<float> column_width;
+	std::vector<float> column_height;
+	std::vector<float> row_width;
+	std::vector<float> row_height;
+	// prefix sums, column_count + 1 and row_count + 1 entries; double
+	// because float is off by whole points beyond 2^24 (~20k pages)
+	std::vector<double> column_position;
+	std::vector<double> row_position;
 	int page_offset;
 };
 
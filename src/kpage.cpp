@@ -6,11 +6,13 @@ using namespace std;
 
 KPage::KPage() :
 		links(NULL),
+		render_time(-1),
 		inverted_colors(false),
 		text(NULL) {
 	for (int i = 0; i < 3; i++) {
 		status[i] = 0;
 		rotation[i] = 0;
+		fast[i] = false;
 	}
 }
 
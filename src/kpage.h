@@ -3,6 +3,7 @@
 
 #include <QImage>
 #include <QMutex>
+#include <map>
 #include <poppler/qt4/poppler-qt4.h>
 
 
@@ -31,6 +32,9 @@ private:
 	QMutex mutex;
 	int status[3];
 	char rotation[3];
+	bool fast[3]; // rendered with the fast profile
+	int render_time; // ms of the last full quality rendering, -1 if unknown
+	std::map<int,std::pair<int,int> > costs; // dpi, render time in ms, output pixels
 	bool inverted_colors; // img[]s and thumb must be consistent
 	QList<SelectionLine *> *text;
 
@@ -0,0 +1,366 @@
+#include <iostream>
+#include <QImage>
+#include <QApplication>
+#include "continuouslayout.h"
+#include "../util.h"
+#include "layout.h"
+#include "../viewer.h"
+#include "../resourcemanager.h"
+#include "../search.h"
+#include "../config.h"
+#include "../kpage.h"
+
+using namespace std;
+
+
+//==[ ContinuousLayout ]=======================================================
+ContinuousLayout::ContinuousLayout(Viewer *v, int render_index, int page) :
+		SmoothLayout(v, render_index, page),
+		max_width(0.0f),
+		off_x(0), scroll_y(0),
+		last_visible_page(0),
+		zoom(0),
+		total_width(0), total_height(0) {
+	build_offsets();
+	set_constants();
+}
+
+ContinuousLayout::~ContinuousLayout() {
+}
+
+void ContinuousLayout::build_offsets() {
+	int count = res->get_page_count();
+	page_position.resize(count + 1);
+	page_position[0] = 0.0;
+	max_width = 0.0f;
+	for (int i = 0; i < count; i++) {
+		page_position[i + 1] = page_position[i] + res->get_page_height(i);
+		if (res->get_page_width(i) > max_width) {
+			max_width = res->get_page_width(i);
+		}
+	}
+}
+
+void ContinuousLayout::set_constants() {
+	if (res->get_page_count() == 0 || max_width <= 0.0f) {
+		total_width = 0;
+		total_height = 0;
+		return;
+	}
+
+	// the widest page fits the window
+	int available = width;
+	if (available < min_page_width) {
+		available = min_page_width;
+	}
+	size = available / max_width;
+
+	// apply zoom value
+	size *= (1 + zoom * zoom_factor);
+
+	total_width = ROUND(max_width * size);
+	total_height = page_to_pixel(page_position.size() - 1) - useless_gap;
+}
+
+void ContinuousLayout::clamp_view() {
+	// vertical
+	if (total_height <= height) { // center view
+		scroll_y = -(height - total_height) / 2;
+	} else if (scroll_y < 0) {
+		scroll_y = 0;
+	} else if (scroll_y > total_height - height) {
+		scroll_y = total_height - height;
+	}
+
+	// horizontal
+	if (total_width <= width) { // center view
+		off_x = (width - total_width) / 2;
+	} else if (off_x > 0) {
+		off_x = 0;
+	} else if (off_x < width - total_width) {
+		off_x = width - total_width;
+	}
+
+	page = pixel_to_page(max(scroll_y, 0));
+}
+
+void ContinuousLayout::activate(const Layout *old_layout) {
+	Layout::activate(old_layout);
+	set_constants();
+	scroll_y = page_to_pixel(page);
+	clamp_view();
+}
+
+void ContinuousLayout::rebuild(bool clamp) {
+	// keep the position relative to the current page
+	float rel = (scroll_y - page_to_pixel(page)) / size;
+	Layout::rebuild(clamp);
+	build_offsets();
+	set_constants();
+	scroll_y = page_to_pixel(page) + rel * size;
+	// an unclamped view is kept as it is until the next move
+	if (clamp) {
+		clamp_view();
+	}
+}
+
+void ContinuousLayout::resize(int w, int h) {
+	float old_size = size;
+	Layout::resize(w, h);
+	set_constants();
+
+	off_x = off_x * size / old_size;
+	scroll_y = scroll_y * size / old_size;
+	clamp_view();
+}
+
+void ContinuousLayout::set_zoom(int new_zoom, bool relative) {
+	float old_factor = 1 + zoom * zoom_factor;
+	float old_size = size;
+	int old_page = page;
+	if (relative) {
+		zoom += new_zoom;
+	} else {
+		zoom = new_zoom;
+	}
+	if (zoom < min_zoom) {
+		zoom = min_zoom;
+	} else if (zoom > max_zoom) {
+		zoom = max_zoom;
+	}
+	float new_factor = 1 + zoom * zoom_factor;
+
+	if (old_factor == new_factor) {
+		return;
+	}
+
+	set_constants();
+	// zoom around the center of the view
+	off_x = (off_x - width / 2) * size / old_size + width / 2;
+	scroll_y = (scroll_y + height / 2) * size / old_size - height / 2;
+	clamp_view();
+	viewer->layout_updated(page, page != old_page);
+}
+
+bool ContinuousLayout::scroll_smooth_noupdate(int dx, int dy) {
+	int old_off_x = off_x;
+	int old_scroll_y = scroll_y;
+	int old_page = page;
+
+	off_x += dx;
+	scroll_y -= dy;
+	clamp_view();
+
+	return off_x != old_off_x || scroll_y != old_scroll_y || page != old_page;
+}
+
+void ContinuousLayout::scroll_smooth(int dx, int dy) {
+	int old_page = page;
+	planner.record(-dy);
+	if (scroll_smooth_noupdate(dx, dy)) {
+		viewer->layout_updated(page, page != old_page);
+	}
+}
+
+void ContinuousLayout::scroll_page(int new_page, bool relative) {
+	int old_page = page;
+	int old_scroll_y = scroll_y;
+
+	if (relative) {
+		new_page += page;
+	}
+	if (new_page < 0) {
+		new_page = 0;
+	} else if (new_page >= res->get_page_count()) {
+		new_page = res->get_page_count() - 1;
+	}
+
+	// keep the position relative to the top of the page
+	scroll_y += page_to_pixel(new_page) - page_to_pixel(page);
+	clamp_view();
+
+	if (scroll_y != old_scroll_y || page != old_page) {
+		planner.record(scroll_y - old_scroll_y);
+		viewer->layout_updated(page, page != old_page);
+	}
+}
+
+void ContinuousLayout::scroll_page_top_jump(int new_page, bool relative) {
+	res->store_jump(get_page());
+	int old_page = page;
+	int old_scroll_y = scroll_y;
+
+	if (relative) {
+		new_page += page;
+	}
+	if (new_page < 0) {
+		new_page = 0;
+	} else if (new_page >= res->get_page_count()) {
+		new_page = res->get_page_count() - 1;
+	}
+
+	scroll_y = page_to_pixel(new_page);
+	clamp_view();
+
+	if (scroll_y != old_scroll_y || page != old_page) {
+		viewer->layout_updated(page, page != old_page);
+	}
+}
+
+void ContinuousLayout::render(QPainter *painter) {
+	if (res->get_page_count() == 0) {
+		return;
+	}
+
+	int cur_page = page;
+	int last_page = page;
+	int hpos;
+	while (cur_page < res->get_page_count() &&
+			(hpos = page_to_pixel(cur_page) - scroll_y) < height) {
+		int page_width = res->get_page_width(cur_page) * size;
+		int page_height = ROUND(res->get_page_height(cur_page) * size);
+		// every page is centered in the column at its own width
+		int wpos = off_x + (total_width - page_width) / 2;
+
+		// simple pages are painted as vectors, crisp at any zoom
+		if (!res->render_direct(painter, cur_page, QRect(wpos, hpos, page_width, page_height))) {
+			const KPage *k_page = res->get_page(cur_page, page_width, render_index);
+			if (k_page != NULL) {
+				const QImage *img = k_page->get_image();
+				if (img != NULL) {
+					int rot = (res->get_rotation() - k_page->get_rotation() + 4) % 4;
+					QRect rect;
+					painter->rotate(rot * 90);
+					// calculate page position
+					if (rot == 0) {
+						rect = QRect(wpos, hpos, page_width, page_height);
+					} else if (rot == 1) {
+						rect = QRect(hpos, -wpos - page_width,
+								page_height, page_width);
+					} else if (rot == 2) {
+						rect = QRect(-wpos - page_width, -hpos - page_height,
+								page_width, page_height);
+					} else if (rot == 3) {
+						rect = QRect(-hpos - page_height, wpos,
+								page_height, page_width);
+					}
+					// draw scaled
+					if (page_width != k_page->get_width() || rot != 0) {
+						painter->drawImage(rect, *img);
+					} else { // draw as-is
+						painter->drawImage(rect.topLeft(), *img);
+					}
+					painter->rotate(-rot * 90);
+				} else {
+					render_blank_page_background(painter, wpos, hpos, page_width, page_height);
+				}
+				res->unlock_page(cur_page);
+			}
+		}
+
+		// draw search rects
+		QPoint offset(wpos, hpos);
+		if (search_visible) {
+			render_search_rects(painter, cur_page, offset, size);
+		}
+
+		// draw text selection
+		render_selection(painter, cur_page, offset, size);
+
+		last_page = cur_page;
+		cur_page++;
+	}
+	last_visible_page = last_page;
+
+	// prefetch, further in the direction of motion
+	float page_height = (float) total_height / res->get_page_count();
+	int count_forward = prefetch_count;
+	int count_backward = prefetch_count;
+	if (planner.get_direction() > 0) {
+		count_forward = planner.get_ahead(prefetch_count, page_height);
+		count_backward = planner.get_behind(prefetch_count);
+	} else if (planner.get_direction() < 0) {
+		count_forward = planner.get_behind(prefetch_count);
+		count_backward = planner.get_ahead(prefetch_count, page_height);
+	}
+	int keep = max(prefetch_count * 3, max(count_forward, count_backward));
+	res->collect_garbage(page - keep, last_page + keep);
+
+	for (int count = 1; count <= max(count_forward, count_backward); count++) {
+		// after last visible page
+		if (count <= count_forward) {
+			int p = last_page + count;
+			res->prefetch(p, res->get_page_width(p) * size, render_index);
+		}
+		// before first visible page
+		if (count <= count_backward) {
+			int p = page - count;
+			res->prefetch(p, res->get_page_width(p) * size, render_index);
+		}
+	}
+}
+
+QPoint ContinuousLayout::get_target_page_distance(int target_page) const {
+	int page_width = res->get_page_width(target_page) * size;
+	return QPoint(off_x + (total_width - page_width) / 2,
+			page_to_pixel(target_page) - scroll_y);
+}
+
+pair<int, QPointF> ContinuousLayout::get_location_at(int mx, int my) const {
+	int cur_page = pixel_to_page(my + scroll_y);
+	QPoint pos = get_target_page_distance(cur_page);
+
+	int page_width = res->get_page_width(cur_page) * size;
+	int page_height = ROUND(res->get_page_height(cur_page) * size);
+
+	// transform mouse coordinates
+	float x = (mx - pos.x()) / (float) page_width;
+	float y = (my - pos.y()) / (float) page_height;
+
+	// apply rotation
+	int rotation = res->get_rotation();
+	if (rotation == 1) {
+		float tmp = x;
+		x = y;
+		y = 1 - tmp;
+	} else if (rotation == 2) {
+		x = 1 - x;
+		y = 1 - y;
+	} else if (rotation == 3) {
+		float tmp = y;
+		y = x;
+		x = 1 - tmp;
+	}
+
+	return make_pair(cur_page, QPointF(x, y));
+}
+
+bool ContinuousLayout::page_visible(int p) const {
+	return p >= page && p <= last_visible_page;
+}
+
+int ContinuousLayout::page_to_pixel(int p) const {
+	int count = page_position.size() - 1;
+	if (p < 0) {
+		p = 0;
+	} else if (p > count) {
+		p = count;
+	}
+	return ROUND(page_position[p] * size) + p * useless_gap;
+}
+
+int ContinuousLayout::pixel_to_page(int y) const {
+	// binary search for the last page starting at or above y
+	int low = 0;
+	int high = page_position.size() - 2;
+	while (low < high) {
+		int mid = (low + high + 1) / 2;
+		if (page_to_pixel(mid) <= y) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return low;
+}
+
@@ -0,0 +1,57 @@
+#ifndef CONTINUOUSLAYOUT_H
+#define CONTINUOUSLAYOUT_H
+
+#include <vector>
+#include "smoothlayout.h"
+
+
+// pages stacked on top of each other, each one at its own height
+class ContinuousLayout : public SmoothLayout {
+public:
+	ContinuousLayout(Viewer *v, int render_index, int page = 0);
+	~ContinuousLayout();
+
+	void activate(const Layout *old_layout);
+	void rebuild(bool clamp = true);
+	void resize(int w, int h);
+	void set_zoom(int new_zoom, bool relative = true);
+
+	void scroll_smooth(int dx, int dy);
+	void scroll_page(int new_page, bool relative = true);
+	void scroll_page_top_jump(int new_page, bool relative = true);
+	void render(QPainter *painter);
+
+	std::pair<int, QPointF> get_location_at(int pixel_x, int pixel_y) const;
+
+	bool page_visible(int p) const;
+
+protected:
+	// internal functions for nested use
+	// they don't call the viewer that stuff needs updating
+	bool scroll_smooth_noupdate(int dx, int dy);
+	QPoint get_target_page_distance(int target_page) const;
+
+private:
+	void build_offsets();
+	void set_constants();
+	void clamp_view();
+
+	// pixel position of a page's top edge, gaps included
+	int page_to_pixel(int p) const;
+	int pixel_to_page(int y) const;
+
+	// prefix sums of page heights, double because float is off by whole
+	// points beyond 2^24
+	std::vector<double> page_position;
+	float max_width;
+
+	int off_x;
+	int scroll_y; // top edge of the view in document pixels
+	int last_visible_page;
+	int zoom;
+	int total_width;
+	int total_height;
+};
+
+#endif
+
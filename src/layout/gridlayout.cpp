@@ -17,7 +17,7 @@ using namespace std;
 
 //==[ GridLayout ]=============================================================
 GridLayout::GridLayout(Viewer *v, int render_index, int page, int columns) :
-		Layout(v, render_index, page),
+		SmoothLayout(v, render_index, page),
 		off_x(0), off_y(0),
 		horizontal_page(0),
 		last_visible_page(res->get_page_count() - 1),
@@ -55,10 +55,7 @@ void GridLayout::set_constants(bool clamp) {
 	}
 
 	// calculate fit
-	float used = 0;
-	for (int i = 0; i < grid->get_column_count(); i++) {
-		used += grid->get_width(i);
-	}
+	double used = grid->get_column_position(grid->get_column_count());
 	int available = width - useless_gap * (grid->get_column_count() - 1);
 	if (available < min_page_width * grid->get_column_count()) {
 		available = min_page_width * grid->get_column_count();
@@ -71,41 +68,21 @@ void GridLayout::set_constants(bool clamp) {
 	horizontal_page = (page + horizontal_page) % grid->get_column_count();
 	page = page / grid->get_column_count() * grid->get_column_count();
 
-	total_height = 0;
-	for (int i = 0; i < grid->get_row_count(); i++) {
-		total_height += ROUND(grid->get_height(i) * size);
-	}
-	total_height += useless_gap * (grid->get_row_count() - 1);
-
-	total_width = 0;
-	for (int i = 0; i < grid->get_column_count(); i++) {
-		total_width += grid->get_width(i) * size;
-	}
-	total_width += useless_gap * (grid->get_column_count() - 1);
+	total_height = row_to_pixel(grid->get_row_count()) - useless_gap;
+	total_width = column_to_pixel(grid->get_column_count()) - useless_gap;
 
 	// calculate offset for blocking at the right border
 	border_page_w = grid->get_column_count();
-	int w = 0;
-	for (int i = grid->get_column_count() - 1; i >= 0; i--) {
-		w += grid->get_width(i) * size;
-		if (w >= width) {
-			border_page_w = i;
-			border_off_w = width - w;
-			break;
-		}
-		w += useless_gap;
+	if (total_width >= width) {
+		border_page_w = pixel_to_column(total_width - width);
+		border_off_w = width - (total_width - column_to_pixel(border_page_w));
 	}
 	// bottom border
 	border_page_h = grid->get_row_count() * grid->get_column_count();
-	int h = 0;
-	for (int i = grid->get_row_count() - 1; i >= 0; i--) {
-		h += ROUND(grid->get_height(i) * size);
-		if (h >= height) {
-			border_page_h = i * grid->get_column_count();
-			border_off_h = height - h;
-			break;
-		}
-		h += useless_gap;
+	if (total_height >= height) {
+		int row = pixel_to_row(total_height - height);
+		border_page_h = row * grid->get_column_count();
+		border_off_h = height - (total_height - row_to_pixel(row));
 	}
 
 	// update view
@@ -123,10 +100,8 @@ void GridLayout::activate(const Layout *old_layout) {
 void GridLayout::rebuild(bool clamp) {
 	Layout::rebuild(clamp);
 	// rebuild non-dynamic data
-	int columns = grid->get_column_count();
-	int offset = grid->get_offset();
-	delete grid;
-	initialize(columns, offset, clamp);
+	grid->update();
+	set_constants(clamp);
 }
 
 void GridLayout::resize(int w, int h) {
@@ -209,20 +184,11 @@ bool GridLayout::scroll_smooth_noupdate(int dx, int dy) {
 		page = 0;
 		off_y = (height - total_height) / 2;
 	} else {
-		int h; // implicit rounding
-		// page up
-		while (off_y > 0 &&
-				(h = ROUND(grid->get_height(page / grid->get_column_count() - 1) * size)) > 0) {
-			off_y -= h + useless_gap;
-			page -= grid->get_column_count();
-		}
-		// page down
-		while ((h = ROUND(grid->get_height(page / grid->get_column_count()) * size)) > 0 &&
-				page < border_page_h &&
-				off_y <= -h - useless_gap) {
-			off_y += h + useless_gap;
-			page += grid->get_column_count();
-		}
+		// find the row at the top edge of the viewport
+		int top = row_to_pixel(page / grid->get_column_count()) - off_y;
+		int row = pixel_to_row(top);
+		page = row * grid->get_column_count();
+		off_y = row_to_pixel(row) - top;
 		// top and bottom borders
 		if (page == 0 && off_y > 0) {
 			off_y = 0;
@@ -238,21 +204,10 @@ bool GridLayout::scroll_smooth_noupdate(int dx, int dy) {
 		horizontal_page = 0;
 		off_x = (width - total_width) / 2;
 	} else {
-		int w; // implicit rounding
-		// page left
-		while (off_x > 0 &&
-				(w = grid->get_width(horizontal_page - 1) * size) > 0) {
-			off_x -= w + useless_gap;
-			horizontal_page--;
-		}
-		// page right
-		while ((w = grid->get_width(horizontal_page) * size) > 0 &&
-				horizontal_page < border_page_w &&
-				horizontal_page < grid->get_column_count() - 1 && // only for horizontal
-				off_x <= -w - useless_gap) {
-			off_x += w + useless_gap;
-			horizontal_page++;
-		}
+		// find the column at the left edge of the viewport
+		int left = column_to_pixel(horizontal_page) - off_x;
+		horizontal_page = pixel_to_column(left);
+		off_x = column_to_pixel(horizontal_page) - left;
 		// left and right borders
 		if (horizontal_page == 0 && off_x > 0) {
 			off_x = 0;
@@ -267,6 +222,7 @@ bool GridLayout::scroll_smooth_noupdate(int dx, int dy) {
 
 void GridLayout::scroll_smooth(int dx, int dy) {
 	int old_page = get_page();
+	planner.record(-dy);
 	if (scroll_smooth_noupdate(dx, dy)) {
 		viewer->layout_updated(get_page(), get_page() != old_page);
 	}
@@ -326,17 +282,7 @@ void GridLayout::scroll_page_top_jump(int new_page, bool relative) {
 	int column_index = (new_page + grid->get_offset()) % grid->get_column_count();
 
 	// calculate pixel offset
-	int offset = 0;
-//	horizontal_page = 0;
-	if (column_index >= horizontal_page) {
-		for (int i = horizontal_page; i < column_index; i++) {
-			offset += grid->get_width(i) * size + useless_gap;
-		}
-	} else {
-		for (int i = horizontal_page; i >= column_index; i--) {
-			offset -= grid->get_width(i) * size + useless_gap;
-		}
-	}
+	int offset = column_to_pixel(column_index) - column_to_pixel(horizontal_page);
 
 	// move viewport
 	change |= scroll_smooth_noupdate(-off_x - offset, -off_y);
@@ -347,18 +293,19 @@ void GridLayout::scroll_page_top_jump(int new_page, bool relative) {
 }
 
 void GridLayout::render(QPainter *painter) {
+	int overview_size = res->get_overview_page_size();
+
 	// vertical
 	int cur_page = page;
 	int last_page = page + horizontal_page;
 	int grid_height; // implicit rounding
 	int hpos = off_y;
-	while ((grid_height = ROUND(grid->get_height(cur_page / grid->get_column_count()) * size)) > 0 && hpos < height) {
+	while ((grid_height = get_row_height(cur_page / grid->get_column_count())) > 0 && hpos < height) {
 		// horizontal
 		int cur_col = horizontal_page;
 		int grid_width; // implicit rounding
 		int wpos = off_x;
-		while ((grid_width = grid->get_width(cur_col) * size) > 0 &&
-				cur_col < grid->get_column_count() &&
+		while ((grid_width = get_column_width(cur_col)) > 0 &&
 				wpos < width) {
 			last_page = cur_page + cur_col - grid->get_offset();
 
@@ -368,39 +315,49 @@ void GridLayout::render(QPainter *painter) {
 			int center_x = (grid_width - page_width) / 2;
 			int center_y = (grid_height - page_height) / 2;
 
-			const KPage *k_page = res->get_page(last_page, page_width, render_index);
-			if (k_page != NULL) {
-				const QImage *img = k_page->get_image();
-				if (img != NULL) {
-					int rot = (res->get_rotation() - k_page->get_rotation() + 4) % 4;
-					QRect rect;
-					painter->rotate(rot * 90);
-					// calculate page position
-					if (rot == 0) {
-						rect = QRect(wpos + center_x, hpos + center_y,
-								page_width, page_height);
-					} else if (rot == 1) {
-						rect = QRect(hpos + center_y, -wpos - center_x - page_width,
-								page_height, page_width);
-					} else if (rot == 2) {
-						rect = QRect(-wpos - center_x - page_width,
-								-hpos - center_y - page_height,
-								page_width, page_height);
-					} else if (rot == 3) {
-						rect = QRect(-hpos - center_y - page_height, wpos + center_x,
-								page_height, page_width);
-					}
-					// draw scaled
-					if (page_width != k_page->get_width() || rot != 0) {
-						painter->drawImage(rect, *img);
-					} else { // draw as-is
-						painter->drawImage(rect.topLeft(), *img);
-					}
-					painter->rotate(-rot * 90);
-				} else {
+			// tiny pages come from the overview atlas instead of single renderings
+			// empty cells before the first and after the last page have no size
+			if (last_page >= 0 && last_page < res->get_page_count() &&
+					page_width <= overview_size && page_height <= overview_size) {
+				if (!res->render_overview(painter, last_page, QRect(wpos + center_x, hpos + center_y, page_width, page_height))) {
 					render_blank_page_background(painter, wpos + center_x, hpos + center_y, page_width, page_height);
 				}
-				res->unlock_page(last_page);
+			// simple pages are painted as vectors, crisp at any zoom
+			} else if (!res->render_direct(painter, last_page, QRect(wpos + center_x, hpos + center_y, page_width, page_height))) {
+				const KPage *k_page = res->get_page(last_page, page_width, render_index);
+				if (k_page != NULL) {
+					const QImage *img = k_page->get_image();
+					if (img != NULL) {
+						int rot = (res->get_rotation() - k_page->get_rotation() + 4) % 4;
+						QRect rect;
+						painter->rotate(rot * 90);
+						// calculate page position
+						if (rot == 0) {
+							rect = QRect(wpos + center_x, hpos + center_y,
+									page_width, page_height);
+						} else if (rot == 1) {
+							rect = QRect(hpos + center_y, -wpos - center_x - page_width,
+									page_height, page_width);
+						} else if (rot == 2) {
+							rect = QRect(-wpos - center_x - page_width,
+									-hpos - center_y - page_height,
+									page_width, page_height);
+						} else if (rot == 3) {
+							rect = QRect(-hpos - center_y - page_height, wpos + center_x,
+									page_height, page_width);
+						}
+						// draw scaled
+						if (page_width != k_page->get_width() || rot != 0) {
+							painter->drawImage(rect, *img);
+						} else { // draw as-is
+							painter->drawImage(rect.topLeft(), *img);
+						}
+						painter->rotate(-rot * 90);
+					} else {
+						render_blank_page_background(painter, wpos + center_x, hpos + center_y, page_width, page_height);
+					}
+					res->unlock_page(last_page);
+				}
 			}
 
 			// draw search rects
@@ -420,97 +377,53 @@ void GridLayout::render(QPainter *painter) {
 	}
 
 	last_visible_page = last_page;
-	res->collect_garbage(page + horizontal_page - grid->get_offset() - prefetch_count * 3, last_page + prefetch_count * 3);
-
-	// prefetch
-	int prefetch_first = page + horizontal_page - grid->get_offset() - 1;
-	int prefetch_last = last_visible_page + 1;
-	for (int count = 0; count < prefetch_count; count++) {
-		// after last visible page
-		int page_width = res->get_page_width(prefetch_last + count) * size;
-		if (res->get_page(prefetch_last + count, page_width, render_index) != NULL) {
-			res->unlock_page(prefetch_last + count);
+
+	// prefetch whole rows, further in the direction of motion
+	int columns = grid->get_column_count();
+	int first_row = page / columns;
+	int last_row = (last_page + grid->get_offset()) / columns;
+	int base_rows = (prefetch_count + columns - 1) / columns;
+	float row_height = (float) total_height / grid->get_row_count();
+	int rows_forward = base_rows;
+	int rows_backward = base_rows;
+	if (planner.get_direction() > 0) {
+		rows_forward = planner.get_ahead(base_rows, row_height);
+		rows_backward = planner.get_behind(base_rows);
+	} else if (planner.get_direction() < 0) {
+		rows_forward = planner.get_behind(base_rows);
+		rows_backward = planner.get_ahead(base_rows, row_height);
+	}
+	int keep = max(prefetch_count * 3, (max(rows_forward, rows_backward) + 1) * columns);
+	res->collect_garbage(page + horizontal_page - grid->get_offset() - keep, last_page + keep);
+
+	for (int count = 1; count <= max(rows_forward, rows_backward); count++) {
+		// after last visible row
+		if (count <= rows_forward) {
+			prefetch_row(last_row + count);
 		}
-		// before first visible page
-		page_width = res->get_page_width(prefetch_first + count) * size;
-		if (res->get_page(prefetch_first + count, page_width, render_index) != NULL) {
-			res->unlock_page(prefetch_first + count);
+		// before first visible row
+		if (count <= rows_backward) {
+			prefetch_row(first_row - count);
 		}
 	}
 }
 
-void GridLayout::advance_invisible_hit(bool forward) {
-	const map<int,QList<QRectF> *> *hits = viewer->get_search_bar()->get_hits();
-
-	if (hits->empty()) {
+void GridLayout::prefetch_row(int row) {
+	if (row < 0 || row >= grid->get_row_count()) {
 		return;
 	}
-
-	QRect r;
-	QList<QRectF>::const_iterator it = hit_it;
-	do {
-		Layout::advance_hit_noupdate(forward);
-		r = get_target_rect(hit_page, *hit_it);
-		if (r.x() < 0 || r.y() < 0 ||
-				r.x() + r.width() >= width ||
-				r.y() + r.height() >= height) {
-			break; // TODO always breaks for boxes larger than the viewport
-		}
-	} while (it != hit_it);
-	view_rect(r);
-}
-
-void GridLayout::view_hit() {
-	QRect r = get_target_rect(hit_page, *hit_it);
-	view_rect(r);
-}
-
-void GridLayout::view_rect(const QRect &r) {
-	int old_page = get_page();
-
-	// move view horizontally
-	if (r.width() <= width * (1 - 2 * jump_padding)) {
-		if (r.x() < width * jump_padding) {
-			scroll_smooth_noupdate(width * jump_padding - r.x(), 0);
-		} else if (r.x() + r.width() > width * (1 - jump_padding)) {
-			scroll_smooth_noupdate(width * (1 - jump_padding) - r.x() - r.width(), 0);
-		}
-	} else {
-		int center = (width - r.width()) / 2;
-		if (center < 0) {
-			center = 0;
-		}
-		scroll_smooth_noupdate(center - r.x(), 0);
-	}
-	// vertically
-	if (r.height() <= height * (1 - 2 * jump_padding)) {
-		if (r.y() < height * jump_padding) {
-			scroll_smooth_noupdate(0, height * jump_padding - r.y());
-		} else if (r.y() + r.height() > height * (1 - jump_padding)) {
-			scroll_smooth_noupdate(0, height * (1 - jump_padding) - r.y() - r.height());
-		}
-	} else {
-		int center = (height - r.height()) / 2;
-		if (center < 0) {
-			center = 0;
+	int first = row * grid->get_column_count() - grid->get_offset();
+	int last = min(first + grid->get_column_count(), res->get_page_count());
+	int overview_size = res->get_overview_page_size();
+	for (int i = max(first, 0); i < last; i++) {
+		int page_width = res->get_page_width(i) * size;
+		int page_height = ROUND(res->get_page_height(i) * size);
+		if (page_width <= overview_size && page_height <= overview_size) {
+			res->prefetch_overview(i);
+		} else {
+			res->prefetch(i, page_width, render_index);
 		}
-		scroll_smooth_noupdate(0, center - r.y());
 	}
-	// needs to redraw regardless of change
-	viewer->layout_updated(get_page(), get_page() != old_page);
-}
-
-void GridLayout::view_point(const QPoint &p) {
-	res->store_jump(get_page());
-	scroll_smooth(-p.x(), -p.y());
-}
-
-QRect GridLayout::get_target_rect(int target_page, QRectF target_rect) const {
-	// get rect coordinates relative to the current view
-	QRectF rot = rotate_rect(target_rect, res->get_page_width(target_page),
-			res->get_page_height(target_page), res->get_rotation());
-	QPoint p = get_target_page_distance(target_page);
-	return transform_rect(rot, size, p.x(), p.y());
 }
 
 QPoint GridLayout::get_target_page_distance(int target_page) const {
@@ -519,63 +432,31 @@ QPoint GridLayout::get_target_page_distance(int target_page) const {
 	int page_width = res->get_page_width(target_page) * size;
 	int page_height = ROUND(res->get_page_height(target_page) * size);
 
-	int center_x = (grid->get_width(target_page_offset % grid->get_column_count()) * size - page_width) / 2;
-	int center_y = (ROUND(grid->get_height(target_page_offset / grid->get_column_count()) * size) - page_height) / 2;
+	int target_col = target_page_offset % grid->get_column_count();
+	int target_row = target_page_offset / grid->get_column_count();
 
-	int wpos = off_x;
-	if (target_page_offset % grid->get_column_count() > horizontal_page) {
-		for (int i = horizontal_page; i < target_page_offset % grid->get_column_count(); i++) {
-			wpos += grid->get_width(i) * size + useless_gap;
-		}
-	} else {
-		for (int i = horizontal_page; i > target_page_offset % grid->get_column_count(); i--) {
-			wpos -= grid->get_width(i) * size + useless_gap;
-		}
-	}
-	int hpos = off_y;
-	if (target_page_offset > page) {
-		for (int i = (page + grid->get_offset()) / grid->get_column_count();
-				i < target_page_offset / grid->get_column_count(); i++) {
-			hpos += ROUND(grid->get_height(i) * size) + useless_gap;
-		}
-	} else {
-		for (int i = (page + grid->get_offset()) / grid->get_column_count();
-				i > target_page_offset / grid->get_column_count(); i--) {
-			hpos -= ROUND(grid->get_height(i) * size) + useless_gap;
-		}
-	}
+	int center_x = (get_column_width(target_col) - page_width) / 2;
+	int center_y = (get_row_height(target_row) - page_height) / 2;
+
+	int wpos = off_x + column_to_pixel(target_col) - column_to_pixel(horizontal_page);
+	int hpos = off_y + row_to_pixel(target_row) - row_to_pixel(page / grid->get_column_count());
 	return QPoint(wpos + center_x, hpos + center_y);
 }
 
 pair<int, QPointF> GridLayout::get_location_at(int mx, int my) const {
 	// find vertical page
-	int cur_page = page;
-	int grid_height;
-	int hpos = off_y;
-	while ((grid_height = ROUND(grid->get_height(cur_page / grid->get_column_count()) * size)) > 0 &&
-			hpos < height) {
-		if (my < hpos + grid_height) {
-			break;
-		}
-		hpos += grid_height + useless_gap;
-		cur_page += grid->get_column_count();
-	}
+	int first_row = page / grid->get_column_count();
+	int row = pixel_to_row(my - off_y + row_to_pixel(first_row));
+	int hpos = off_y + row_to_pixel(row) - row_to_pixel(first_row);
+	int grid_height = get_row_height(row);
 	// find horizontal page
-	int cur_col = horizontal_page;
-	int grid_width;
-	int wpos = off_x;
-	while ((grid_width = grid->get_width(cur_col) * size) > 0 &&
-			cur_col < grid->get_column_count() &&
-			wpos < width) {
-		if (mx < wpos + grid_width) {
-			break;
-		}
-		wpos += grid_width + useless_gap;
-		cur_col++;
-	}
+	int cur_col = pixel_to_column(mx - off_x + column_to_pixel(horizontal_page));
+	int wpos = off_x + column_to_pixel(cur_col) - column_to_pixel(horizontal_page);
+	int grid_width = get_column_width(cur_col);
 
-	int page_width = res->get_page_width(cur_page + cur_col) * size;
-	int page_height = ROUND(res->get_page_height(cur_page + cur_col) * size);
+	int page = row * grid->get_column_count() + cur_col - grid->get_offset();
+	int page_width = res->get_page_width(page) * size;
+	int page_height = ROUND(res->get_page_height(page) * size);
 
 	int center_x = (grid_width - page_width) / 2;
 	int center_y = (grid_height - page_height) / 2;
@@ -599,40 +480,9 @@ pair<int, QPointF> GridLayout::get_location_at(int mx, int my) const {
 		x = 1 - tmp;
 	}
 
-	int page = cur_page + cur_col - grid->get_offset();
-
 	return make_pair(page, QPointF(x, y));
 }
 
-void GridLayout::goto_link_destination(const Poppler::LinkDestination &link) {
-	int link_page = link.pageNumber() - 1;
-	float w = res->get_page_width(link_page, false);
-	float h = res->get_page_height(link_page, false);
-
-	const QPointF link_point = rotate_point(QPointF(link.left() * w, link.top() * h), w, h, res->get_rotation());
-
-	QPoint p = get_target_page_distance(link_page);
-	if (link.isChangeLeft()) {
-		p.rx() += link_point.x() * size - width * jump_padding;
-	}
-	if (link.isChangeTop()) {
-		p.ry() += link_point.y() * size - height * jump_padding;
-	}
-	view_point(p);
-}
-
-void GridLayout::goto_position(int page, QPointF pos) {
-	float w = res->get_page_width(page, false);
-	float h = res->get_page_height(page, false);
-	pos = rotate_point(pos, w, h, res->get_rotation());
-
-	QPoint p = get_target_page_distance(page);
-	p.rx() += pos.x() * size - width / 2;
-	p.ry() += pos.y() * size - height / 2;
-
-	view_point(p);
-}
-
 void GridLayout::goto_page_at(int mx, int my) {
 	pair<int,QPointF> page = get_location_at(mx, my);
 
@@ -652,7 +502,54 @@ bool GridLayout::page_visible(int p) const {
 	return true;
 }
 
-bool GridLayout::supports_smooth_scrolling() const {
-	return true;
+int GridLayout::row_to_pixel(int row) const {
+	return ROUND(grid->get_row_position(row) * size) + row * useless_gap;
+}
+
+int GridLayout::column_to_pixel(int col) const {
+	return ROUND(grid->get_column_position(col) * size) + col * useless_gap;
+}
+
+int GridLayout::pixel_to_row(int y) const {
+	// binary search for the last row starting at or above y
+	int low = 0;
+	int high = grid->get_row_count() - 1;
+	while (low < high) {
+		int mid = (low + high + 1) / 2;
+		if (row_to_pixel(mid) <= y) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return low;
+}
+
+int GridLayout::pixel_to_column(int x) const {
+	int low = 0;
+	int high = grid->get_column_count() - 1;
+	while (low < high) {
+		int mid = (low + high + 1) / 2;
+		if (column_to_pixel(mid) <= x) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return low;
+}
+
+int GridLayout::get_row_height(int row) const {
+	if (row < 0 || row >= grid->get_row_count()) {
+		return -1;
+	}
+	return row_to_pixel(row + 1) - row_to_pixel(row) - useless_gap;
+}
+
+int GridLayout::get_column_width(int col) const {
+	if (col < 0 || col >= grid->get_column_count()) {
+		return -1;
+	}
+	return column_to_pixel(col + 1) - column_to_pixel(col) - useless_gap;
 }
 
@@ -101,7 +101,9 @@ void Layout::scroll_smooth(int /*dx*/, int /*dy*/) {
 }
 
 void Layout::scroll_page(int new_page, bool relative) {
+	int old_page = page;
 	if (scroll_page_noupdate(new_page, relative)) {
+		planner.record(page - old_page);
 		viewer->layout_updated(page, true);
 	}
 }
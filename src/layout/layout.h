@@ -7,6 +7,7 @@
 #include <poppler/qt4/poppler-qt4.h>
 #include <map>
 #include "../selection.h"
+#include "../prefetchplanner.h"
 
 
 class Viewer;
@@ -96,6 +97,7 @@ protected:
 	float jump_padding;
 
 	MouseSelection selection;
+	PrefetchPlanner planner;
 };
 
 
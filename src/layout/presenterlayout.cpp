@@ -179,18 +179,29 @@ void PresenterLayout::render(QPainter *painter) {
 		render_selection(painter, page + i, offset, factor);
 	}
 
-	// prefetch
-	for (int count = 1; count <= prefetch_count; count++) {
+	// prefetch, further in the direction of motion
+	int count_forward = prefetch_count;
+	int count_backward = prefetch_count;
+	if (planner.get_direction() > 0) {
+		count_forward = planner.get_ahead(prefetch_count);
+		count_backward = planner.get_behind(prefetch_count);
+	} else if (planner.get_direction() < 0) {
+		count_forward = planner.get_behind(prefetch_count);
+		count_backward = planner.get_ahead(prefetch_count);
+	}
+	int keep = max(prefetch_count * 3, max(count_forward, count_backward));
+	res->collect_garbage(page - keep, page + 1 + keep);
+
+	for (int count = 1; count <= max(count_forward, count_backward); count++) {
 		// after current page
-		if (res->get_page(page + count, calculate_fit_width(page + count), render_index) != NULL) {
-			res->unlock_page(page + count);
+		if (count <= count_forward) {
+			res->prefetch(page + count, calculate_fit_width(page + count), render_index);
 		}
 		// before current page
-		if (res->get_page(page - count, calculate_fit_width(page - count), render_index) != NULL) {
-			res->unlock_page(page - count);
+		if (count <= count_backward) {
+			res->prefetch(page - count, calculate_fit_width(page - count), render_index);
 		}
 	}
-	res->collect_garbage(page - prefetch_count * 3, page + 1 + prefetch_count * 3);
 }
 
 void PresenterLayout::advance_invisible_hit(bool forward) {
@@ -101,18 +101,59 @@ void SingleLayout::render(QPainter *painter) {
 		}
 	} */
 
-	// prefetch
-	for (int count = 1; count <= prefetch_count; count++) {
+	// prefetch, further in the direction of motion
+	int count_forward = prefetch_count;
+	int count_backward = prefetch_count;
+	if (planner.get_direction() > 0) {
+		count_forward = planner.get_ahead(prefetch_count);
+		count_backward = planner.get_behind(prefetch_count);
+	} else if (planner.get_direction() < 0) {
+		count_forward = planner.get_behind(prefetch_count);
+		count_backward = planner.get_ahead(prefetch_count);
+	}
+	int keep = max(prefetch_count * 3, max(count_forward, count_backward));
+	res->collect_garbage(page - keep, page + keep);
+
+	for (int count = 1; count <= max(count_forward, count_backward); count++) {
 		// after current page
-		if (res->get_page(page + count, calculate_fit_width(page + count), render_index) != NULL) {
-			res->unlock_page(page + count);
+		if (count <= count_forward) {
+			res->prefetch(page + count, calculate_fit_width(page + count), render_index);
 		}
 		// before current page
-		if (res->get_page(page - count, calculate_fit_width(page - count), render_index) != NULL) {
-			res->unlock_page(page - count);
+		if (count <= count_backward) {
+			res->prefetch(page - count, calculate_fit_width(page - count), render_index);
 		}
 	}
-	res->collect_garbage(page - prefetch_count * 3, page + prefetch_count * 3);
+}
+
+void SingleLayout::prerender(int count) {
+	set<int> pages;
+	for (int i = 1; i <= count && page + i < res->get_page_count(); i++) {
+		pages.insert(page + i);
+	}
+
+	// slides reachable through links on the current slide
+	const QList<Poppler::Link *> *links = res->get_links(page);
+	if (links != NULL) {
+		Q_FOREACH(Poppler::Link *l, *links) {
+			if (l->linkType() != Poppler::Link::Goto) {
+				continue;
+			}
+			Poppler::LinkGoto *link = static_cast<Poppler::LinkGoto *>(l);
+			if (link->isExternal()) {
+				continue;
+			}
+			int target = link->destination().pageNumber() - 1;
+			if (target >= 0 && target < res->get_page_count() && target != page) {
+				pages.insert(target);
+			}
+		}
+	}
+
+	res->set_pinned(pages);
+	for (set<int>::iterator it = pages.begin(); it != pages.end(); ++it) {
+		res->prefetch(*it, calculate_fit_width(*it), render_index);
+	}
 }
 
 void SingleLayout::advance_invisible_hit(bool forward) {
@@ -11,6 +11,8 @@ public:
 
 	const QRect calculate_placement(int page) const;
 	void render(QPainter *painter);
+	// renders the next count pages and link targets ahead of time and keeps them
+	void prerender(int count);
 
 	void advance_invisible_hit(bool forward = true);
 
@@ -0,0 +1,125 @@
+#include "smoothlayout.h"
+#include "../util.h"
+#include "../viewer.h"
+#include "../resourcemanager.h"
+#include "../search.h"
+
+using namespace std;
+
+
+//==[ SmoothLayout ]===========================================================
+SmoothLayout::SmoothLayout(Viewer *v, int render_index, int page) :
+		Layout(v, render_index, page),
+		size(1.0f) {
+}
+
+SmoothLayout::~SmoothLayout() {
+}
+
+void SmoothLayout::advance_invisible_hit(bool forward) {
+	const map<int,QList<QRectF> *> *hits = viewer->get_search_bar()->get_hits();
+
+	if (hits->empty()) {
+		return;
+	}
+
+	QRect r;
+	QList<QRectF>::const_iterator it = hit_it;
+	do {
+		Layout::advance_hit_noupdate(forward);
+		r = get_target_rect(hit_page, *hit_it);
+		if (r.x() < 0 || r.y() < 0 ||
+				r.x() + r.width() >= width ||
+				r.y() + r.height() >= height) {
+			break; // TODO always breaks for boxes larger than the viewport
+		}
+	} while (it != hit_it);
+	view_rect(r);
+}
+
+void SmoothLayout::view_hit() {
+	QRect r = get_target_rect(hit_page, *hit_it);
+	view_rect(r);
+}
+
+void SmoothLayout::view_rect(const QRect &r) {
+	int old_page = get_page();
+
+	// move view horizontally
+	if (r.width() <= width * (1 - 2 * jump_padding)) {
+		if (r.x() < width * jump_padding) {
+			scroll_smooth_noupdate(width * jump_padding - r.x(), 0);
+		} else if (r.x() + r.width() > width * (1 - jump_padding)) {
+			scroll_smooth_noupdate(width * (1 - jump_padding) - r.x() - r.width(), 0);
+		}
+	} else {
+		int center = (width - r.width()) / 2;
+		if (center < 0) {
+			center = 0;
+		}
+		scroll_smooth_noupdate(center - r.x(), 0);
+	}
+	// vertically
+	if (r.height() <= height * (1 - 2 * jump_padding)) {
+		if (r.y() < height * jump_padding) {
+			scroll_smooth_noupdate(0, height * jump_padding - r.y());
+		} else if (r.y() + r.height() > height * (1 - jump_padding)) {
+			scroll_smooth_noupdate(0, height * (1 - jump_padding) - r.y() - r.height());
+		}
+	} else {
+		int center = (height - r.height()) / 2;
+		if (center < 0) {
+			center = 0;
+		}
+		scroll_smooth_noupdate(0, center - r.y());
+	}
+	// needs to redraw regardless of change
+	viewer->layout_updated(get_page(), get_page() != old_page);
+}
+
+void SmoothLayout::view_point(const QPoint &p) {
+	res->store_jump(get_page());
+	scroll_smooth(-p.x(), -p.y());
+}
+
+QRect SmoothLayout::get_target_rect(int target_page, QRectF target_rect) const {
+	// get rect coordinates relative to the current view
+	QRectF rot = rotate_rect(target_rect, res->get_page_width(target_page),
+			res->get_page_height(target_page), res->get_rotation());
+	QPoint p = get_target_page_distance(target_page);
+	return transform_rect(rot, size, p.x(), p.y());
+}
+
+void SmoothLayout::goto_link_destination(const Poppler::LinkDestination &link) {
+	int link_page = link.pageNumber() - 1;
+	float w = res->get_page_width(link_page, false);
+	float h = res->get_page_height(link_page, false);
+
+	const QPointF link_point = rotate_point(QPointF(link.left() * w, link.top() * h), w, h, res->get_rotation());
+
+	QPoint p = get_target_page_distance(link_page);
+	if (link.isChangeLeft()) {
+		p.rx() += link_point.x() * size - width * jump_padding;
+	}
+	if (link.isChangeTop()) {
+		p.ry() += link_point.y() * size - height * jump_padding;
+	}
+	view_point(p);
+}
+
+void SmoothLayout::goto_position(int page, QPointF pos) {
+	float w = res->get_page_width(page, false);
+	float h = res->get_page_height(page, false);
+	pos = rotate_point(pos, w, h, res->get_rotation());
+
+	QPoint p = get_target_page_distance(page);
+	p.rx() += pos.x() * size - width / 2;
+	p.ry() += pos.y() * size - height / 2;
+
+	view_point(p);
+}
+
+bool SmoothLayout::supports_smooth_scrolling() const {
+	return true;
+}
+
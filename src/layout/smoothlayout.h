@@ -0,0 +1,34 @@
+#ifndef SMOOTHLAYOUT_H
+#define SMOOTHLAYOUT_H
+
+#include "layout.h"
+
+
+// base for layouts that scroll by pixels and place pages at a common scale
+class SmoothLayout : public Layout {
+public:
+	SmoothLayout(Viewer *v, int render_index, int page = 0);
+	virtual ~SmoothLayout();
+
+	void advance_invisible_hit(bool forward = true);
+
+	void goto_link_destination(const Poppler::LinkDestination &link);
+	void goto_position(int page, QPointF pos);
+
+	bool supports_smooth_scrolling() const;
+
+protected:
+	virtual bool scroll_smooth_noupdate(int dx, int dy) = 0;
+	// top left corner of a page relative to the view
+	virtual QPoint get_target_page_distance(int target_page) const = 0;
+
+	void view_hit();
+	void view_rect(const QRect &r);
+	void view_point(const QPoint &p);
+	QRect get_target_rect(int target_page, QRectF target_rect) const;
+
+	float size;
+};
+
+#endif
+
@@ -0,0 +1,31 @@
+#include "loaderthread.h"
+
+using namespace std;
+
+
+LoaderThread::LoaderThread() :
+		done(false) {
+}
+
+void LoaderThread::run() {
+	load();
+	mutex.lock();
+	done = true;
+	mutex.unlock();
+}
+
+void LoaderThread::detach() {
+	// checking isRunning() and connecting afterwards would miss a finished()
+	// emitted in between, so connect first and ask whether it is still coming
+	connect(this, SIGNAL(finished()), this, SLOT(deleteLater()));
+	mutex.lock();
+	bool pending = isRunning() && !done;
+	mutex.unlock();
+	if (!pending) {
+		// done or never started; a deleteLater already posted is dropped
+		disconnect(this, SIGNAL(finished()), this, SLOT(deleteLater()));
+		wait();
+		delete this;
+	}
+}
+
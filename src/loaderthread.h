@@ -0,0 +1,32 @@
+#ifndef LOADERTHREAD_H
+#define LOADERTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+
+
+// a background parse that can be abandoned while it runs
+// poppler can't be interrupted, so a detached thread deletes itself when done
+class LoaderThread : public QThread {
+	Q_OBJECT
+
+public:
+	LoaderThread();
+
+	void run();
+
+	// the owner gives up the thread, deleting it now or once it finished
+	// disconnect the owner's slots from finished() first
+	void detach();
+
+protected:
+	// the actual work, in the thread
+	virtual void load() = 0;
+
+private:
+	QMutex mutex;
+	bool done; // load() returned, finished() follows
+};
+
+#endif
+
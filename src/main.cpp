@@ -2,12 +2,16 @@
 #include <QString>
 #include <QProcess>
 #include <iostream>
+#include <cstring>
 #include <getopt.h>
 #include "download.h"
+#include "downloadmanager.h"
 #include "resourcemanager.h"
 #include "viewer.h"
 #include "config.h"
 #include "dbus/dbus.h"
+#include "rasterizer.h"
+#include "rangesource.h"
 
 using namespace std;
 
@@ -24,9 +28,118 @@ static void print_help(char *name) {
 	cout << "  -s, --single-instance true|false  Whether to have a single instance per file" << endl;
 	cout << "  --write-default-config FILE       Write the default configuration to FILE and exit" << endl;
 	cout << "  -h, --help                        Print this help and exit" << endl;
+	cout << endl;
+	cout << "  " << name << " --render [OPTIONS] FILE" << endl;
+	cout << "  Render pages to images without a window, see --render --help" << endl;
+}
+
+static void print_render_help(char *name) {
+	cout << "Usage:" << endl;
+	cout << "  " << name << " --render [OPTIONS] FILE" << endl;
+	cout << endl;
+	cout << "Renders pages to image files or streams them to stdout, no display needed." << endl;
+	cout << endl;
+	cout << "Settings:" << endl;
+	cout << "  -r, --range FIRST[-LAST]  Pages to render, starting at 1 (all)" << endl;
+	cout << "  -d, --dpi NUM             Resolution (72)" << endl;
+	cout << "  -w, --width NUM           Page width in pixels, overrides --dpi" << endl;
+	cout << "  -R, --rotate DEGREES      Rotate clockwise by 0, 90, 180 or 270 degrees (0)" << endl;
+	cout << "  -i, --invert              Invert colors" << endl;
+	cout << "  -j, --jobs NUM            Number of render threads (one per core)" << endl;
+	cout << "  -o, --output PATTERN      File name, %d is replaced by the page number, the" << endl;
+	cout << "                            extension selects the format, e.g. .png or .ppm" << endl;
+	cout << "                            \"-\" writes binary PPM frames to stdout (page-%d.png)" << endl;
+	cout << "  -P, --password PASSWORD   Password of an encrypted document" << endl;
+	cout << "  -h, --help                Print this help and exit" << endl;
+}
+
+static int render_main(int argc, char *argv[]) {
+	QApplication app(argc, argv, false); // no display
+
+	struct option long_options[] = {
+		{"range",		required_argument,	NULL,	'r'},
+		{"dpi",			required_argument,	NULL,	'd'},
+		{"width",		required_argument,	NULL,	'w'},
+		{"rotate",		required_argument,	NULL,	'R'},
+		{"invert",		no_argument,		NULL,	'i'},
+		{"jobs",		required_argument,	NULL,	'j'},
+		{"output",		required_argument,	NULL,	'o'},
+		{"password",	required_argument,	NULL,	'P'},
+		{"help",		no_argument,		NULL,	'h'},
+		{NULL, 0, NULL, 0}
+	};
+	RasterOptions options;
+	QByteArray password;
+	while (1) {
+		int c = getopt_long(argc, argv, "r:d:w:R:ij:o:P:h", long_options, NULL);
+		if (c == -1) {
+			break;
+		}
+		switch (c) {
+			case 'r': {
+				QStringList range = QString(optarg).split('-');
+				options.first_page = range[0].toInt() - 1;
+				if (range.size() == 1) {
+					options.last_page = options.first_page;
+				} else if (!range[1].isEmpty()) {
+					options.last_page = range[1].toInt() - 1;
+				}
+				break;
+			}
+			case 'd':
+				options.dpi = atof(optarg);
+				break;
+			case 'w':
+				options.width = atoi(optarg);
+				break;
+			case 'R': {
+				int degrees = atoi(optarg);
+				if (degrees % 90 != 0 || degrees < 0 || degrees > 270) {
+					cerr << "rotation must be 0, 90, 180 or 270 degrees" << endl;
+					return 1;
+				}
+				options.rotation = degrees / 90;
+				break;
+			}
+			case 'i':
+				options.inverted_colors = true;
+				break;
+			case 'j':
+				options.jobs = atoi(optarg);
+				break;
+			case 'o':
+				options.output = QString::fromUtf8(optarg);
+				break;
+			case 'P':
+				password = optarg;
+				break;
+			case 'h':
+				print_render_help(argv[0]);
+				return 0;
+			default:
+				// getopt prints an error message
+				return 1;
+		}
+	}
+	if (optind != argc - 1) {
+		print_render_help(argv[0]);
+		return 1;
+	}
+
+	Rasterizer rasterizer(QString::fromUtf8(argv[optind]), password, options);
+	if (!rasterizer.is_valid()) {
+		return 1; // the reason is printed
+	}
+	return rasterizer.run() ? 0 : 1;
 }
 
 int main(int argc, char *argv[]) {
+	// headless mode, has to be decided before connecting to the display
+	if (argc > 1 && !strcmp(argv[1], "--render")) {
+		argv[1] = argv[0];
+		return render_main(argc - 1, argv + 1);
+	}
+
 	QApplication app(argc, argv);
 
 	// parse command line options
@@ -86,20 +199,63 @@ int main(int argc, char *argv[]) {
 		}
 	}
 
-	// fork more processes if there are arguments left
-	if (optind < argc - 1) {
-		QStringList l;
-		for (int i = optind + 1; i < argc; i++) {
-			l << argv[i];
-		}
-		QProcess::startDetached(argv[0], l);
+	QStringList l;
+	for (int i = optind + 1; i < argc; i++) {
+		l << argv[i];
 	}
 
 	QString file;
 	Download download;
+	RangeSource range_source;
+	// big documents are only fetched as far as they are viewed
+	if (argv[optind] != NULL && download_url) {
+		qint64 min_size = CFG::get_instance()->get_value("Settings/range_request_min_size").toLongLong() * 1024 * 1024;
+		if (min_size > 0 && range_source.open(QString::fromUtf8(argv[optind]), min_size)) {
+			file = range_source.get_file();
+		}
+	}
+
+	// download all urls at once, the other processes get the cached files
+	QList<int> url_args;
+	for (int i = 0; i < l.size() - 1; i++) {
+		if (l[i] == "-u" || l[i] == "--url") {
+			url_args << i++;
+		}
+	}
+	if (!url_args.isEmpty() && DownloadCache().is_enabled()) {
+		QStringList urls;
+		Q_FOREACH(int i, url_args) {
+			urls << l[i + 1];
+		}
+		bool own_url = argv[optind] != NULL && download_url && file.isNull();
+		if (own_url) {
+			urls << QString::fromUtf8(argv[optind]);
+		}
+
+		DownloadManager downloads;
+		QStringList files = downloads.load(urls);
+		if (own_url) {
+			file = files.takeLast(); // downloaded again below if it failed
+		}
+		// replace "-u URL" by the file, from the back to keep the positions
+		for (int i = url_args.size() - 1; i >= 0; i--) {
+			if (!files[i].isNull()) {
+				l.removeAt(url_args[i]);
+				l[url_args[i]] = files[i];
+			}
+		}
+	}
+
+	// fork more processes if there are arguments left
+	if (!l.isEmpty()) {
+		QProcess::startDetached(argv[0], l);
+	}
+
 	if (argv[optind] != NULL) {
 		if (download_url) {
-			file = download.load(QString::fromUtf8(argv[optind]));
+			if (file.isNull()) {
+				file = download.load(QString::fromUtf8(argv[optind]));
+			}
 		} else {
 			file = QString::fromUtf8(argv[optind]);
 		}
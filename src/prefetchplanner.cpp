@@ -0,0 +1,83 @@
+#include <cmath>
+#include "prefetchplanner.h"
+#include "config.h"
+
+using namespace std;
+
+
+PrefetchPlanner::PrefetchPlanner() :
+		moving(false),
+		velocity(0.0f),
+		direction(0) {
+	// load config options
+	CFG *config = CFG::get_instance();
+	lookahead = config->get_value("Settings/prefetch_lookahead").toFloat();
+	max_count = config->get_value("Settings/prefetch_max_count").toInt();
+	idle_time = config->get_value("Settings/prefetch_idle_time").toInt();
+}
+
+void PrefetchPlanner::record(float delta) {
+	if (delta == 0.0f) {
+		return;
+	}
+	int new_direction = delta > 0.0f ? 1 : -1;
+
+	if (!moving || last_record.elapsed() > idle_time || new_direction != direction) {
+		// start of a new motion, the speed is not known yet
+		velocity = 0.0f;
+		last_record.start();
+	} else {
+		int dt = last_record.restart();
+		if (dt < 5) { // events arriving in bursts would spike the estimate
+			dt = 5;
+		}
+		float current = fabs(delta) * 1000.0f / dt;
+		// smooth over a few events
+		velocity = velocity * 0.5f + current * 0.5f;
+	}
+	moving = true;
+	direction = new_direction;
+}
+
+void PrefetchPlanner::reset() {
+	moving = false;
+	velocity = 0.0f;
+	direction = 0;
+}
+
+float PrefetchPlanner::get_velocity() const {
+	if (!moving || last_record.elapsed() > idle_time) {
+		return 0.0f;
+	}
+	return velocity;
+}
+
+int PrefetchPlanner::get_direction() const {
+	if (!moving || last_record.elapsed() > idle_time) {
+		return 0;
+	}
+	return direction;
+}
+
+int PrefetchPlanner::get_ahead(int base_count, float unit_size) const {
+	if (unit_size <= 0.0f) {
+		return base_count;
+	}
+	int count = base_count + ceil(get_velocity() * lookahead / unit_size);
+	if (count > max_count) {
+		count = max_count;
+	}
+	if (count < base_count) {
+		count = base_count;
+	}
+	return count;
+}
+
+int PrefetchPlanner::get_behind(int base_count) const {
+	// don't waste the worker on pages we are moving away from
+	if (get_velocity() > 0.0f && base_count > 1) {
+		return base_count / 2;
+	}
+	return base_count;
+}
+
@@ -0,0 +1,39 @@
+#ifndef PREFETCHPLANNER_H
+#define PREFETCHPLANNER_H
+
+#include <QTime>
+
+
+// estimates scroll direction and speed to decide how far ahead to prefetch
+class PrefetchPlanner {
+public:
+	PrefetchPlanner();
+
+	// positive deltas move towards the end of the document
+	void record(float delta);
+	void reset();
+
+	// -1, 0 (not moving) or 1
+	int get_direction() const;
+
+	// number of units (pages or rows) to prefetch ahead of/behind the motion
+	// unit_size converts the recorded deltas into units
+	int get_ahead(int base_count, float unit_size = 1.0f) const;
+	int get_behind(int base_count) const;
+
+private:
+	float get_velocity() const;
+
+	QTime last_record;
+	bool moving;
+	float velocity; // deltas per second
+	int direction;
+
+	// config options
+	float lookahead;
+	int max_count;
+	int idle_time;
+};
+
+#endif
+
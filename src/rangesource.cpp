@@ -0,0 +1,469 @@
+#include "rangesource.h"
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QThreadStorage>
+#include <QEventLoop>
+#include <QRegExp>
+#include <QStringList>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+using namespace std;
+
+
+static const qint64 block_size = 64 * 1024;
+// objects up to this size are fetched when opening, they include the page tree
+static const qint64 small_object_size = 16 * 1024;
+// object dictionaries are expected to fit in here
+static const qint64 dict_size = 16 * 1024;
+
+QMutex RangeSource::sources_mutex;
+map<QString,RangeSource *> RangeSource::sources;
+
+// network access objects belong to the thread that created them
+static QThreadStorage<QNetworkAccessManager *> managers;
+
+static QNetworkAccessManager *get_manager() {
+	if (!managers.hasLocalData()) {
+		managers.setLocalData(new QNetworkAccessManager());
+	}
+	return managers.localData();
+}
+
+static QString get_dict(const QByteArray &data) {
+	QString text = QString::fromLatin1(data.constData(), data.size());
+	int stream = text.indexOf("stream");
+	if (stream != -1) {
+		text.truncate(stream);
+	}
+	return text;
+}
+
+static void find_references(const QString &text, vector<int> &refs) {
+	QRegExp ref("(\\d+)\\s+\\d+\\s+R\\b");
+	int pos = 0;
+	while ((pos = ref.indexIn(text, pos)) != -1) {
+		refs.push_back(ref.cap(1).toInt());
+		pos += ref.matchedLength();
+	}
+}
+
+
+RangeSource::RangeSource() :
+		fd(-1),
+		length(0),
+		root(-1) {
+}
+
+RangeSource::~RangeSource() {
+	close();
+}
+
+bool RangeSource::open(const QString &u, qint64 min_size) {
+	url = QUrl(u);
+	if (url.isLocalFile() || url.isRelative()) {
+		return false;
+	}
+
+	QMutexLocker locker(&mutex);
+	length = get_content_length();
+	if (length <= 0 || length < min_size) {
+		return false;
+	}
+
+	// sparse file of the final size, holes are filled on demand
+	QFileInfo info(url.path());
+	QByteArray name = QFile::encodeName(QDir::tempPath() + QDir::separator() +
+			"katarakt-XXXXXX-" + info.fileName());
+	fd = mkstemps(name.data(), info.fileName().length() + 1);
+	if (fd == -1) {
+		cerr << "mkstemps: " << strerror(errno) << endl;
+		return false;
+	}
+	file = QFile::decodeName(name);
+	if (ftruncate(fd, length) == -1) {
+		cerr << "ftruncate: " << strerror(errno) << endl;
+		close();
+		return false;
+	}
+	blocks.assign((length + block_size - 1) / block_size, false);
+
+	// header and trailer, also tells if ranges are supported
+	vector<pair<qint64,qint64> > ranges;
+	ranges.push_back(make_pair((qint64) 0, (qint64) 1024));
+	ranges.push_back(make_pair(length - 4096, (qint64) 4096));
+	if (!fetch(ranges)) {
+		close();
+		return false;
+	}
+	QString tail = QString::fromLatin1(read(length - 4096, 4096));
+	QRegExp startxref("startxref\\s+(\\d+)");
+	if (startxref.lastIndexIn(tail) == -1 || !parse_xref(startxref.cap(1).toLongLong())) {
+		cerr << "no classic xref table, downloading the whole document" << endl;
+		close();
+		return false;
+	}
+
+	// every object ends where the next one starts
+	set<qint64> offsets;
+	for (map<int,qint64>::iterator it = objects.begin(); it != objects.end(); ) {
+		if (it->second <= 0 || it->second >= length) {
+			objects.erase(it++); // broken entry
+		} else {
+			offsets.insert(it->second);
+			++it;
+		}
+	}
+	for (map<qint64,qint64>::iterator it = object_ends.begin(); it != object_ends.end(); ++it) {
+		offsets.insert(it->first); // xref tables
+	}
+	offsets.insert(length);
+	object_ends.clear();
+	for (set<qint64>::iterator it = offsets.begin(); *it != length; ) {
+		qint64 start = *it;
+		object_ends[start] = *++it;
+	}
+
+	// catalog, page tree, fonts descriptors, ...
+	ranges.clear();
+	for (map<int,qint64>::iterator it = objects.begin(); it != objects.end(); ++it) {
+		qint64 size = object_ends[it->second] - it->second;
+		if (size <= small_object_size) {
+			ranges.push_back(make_pair(it->second, size));
+		}
+	}
+	if (!fetch(ranges)) {
+		close();
+		return false;
+	}
+
+	QRegExp pages_ref("/Pages\\s+(\\d+)\\s+\\d+\\s+R");
+	if (pages_ref.indexIn(get_dict(read_object(root, true))) == -1 ||
+			!parse_page_tree(pages_ref.cap(1).toInt(), 0) || pages.empty()) {
+		cerr << "failed to find the pages, downloading the whole document" << endl;
+		close();
+		return false;
+	}
+
+	sources_mutex.lock();
+	sources[file] = this;
+	sources_mutex.unlock();
+	return true;
+}
+
+const QString &RangeSource::get_file() const {
+	return file;
+}
+
+RangeSource *RangeSource::find(const QString &file) {
+	QMutexLocker locker(&sources_mutex);
+	map<QString,RangeSource *>::iterator it = sources.find(file);
+	if (it == sources.end()) {
+		return NULL;
+	}
+	return it->second;
+}
+
+bool RangeSource::fetch_page(int page) {
+	QMutexLocker locker(&mutex);
+	if (page < 0 || page >= (int) pages.size()) {
+		return false;
+	}
+	if (fetched_pages.find(page) != fetched_pages.end()) {
+		return true;
+	}
+
+	// follow the references of the page, one level per round trip
+	// other pages and the page tree are left out, they lead to everything
+	set<int> visited;
+	vector<int> frontier;
+	frontier.push_back(pages[page]);
+	visited.insert(pages[page]);
+	while (!frontier.empty()) {
+		vector<pair<qint64,qint64> > ranges;
+		for (unsigned int i = 0; i < frontier.size(); i++) {
+			qint64 offset = objects[frontier[i]];
+			ranges.push_back(make_pair(offset, min(dict_size, object_ends[offset] - offset)));
+		}
+		if (!fetch(ranges)) {
+			return false;
+		}
+
+		vector<int> refs;
+		for (unsigned int i = 0; i < frontier.size(); i++) {
+			find_references(get_dict(read_object(frontier[i], true)), refs);
+		}
+		frontier.clear();
+		for (unsigned int i = 0; i < refs.size(); i++) {
+			if (objects.find(refs[i]) != objects.end() &&
+					tree.find(refs[i]) == tree.end() &&
+					visited.insert(refs[i]).second) {
+				frontier.push_back(refs[i]);
+			}
+		}
+	}
+
+	// contents, images, fonts
+	vector<pair<qint64,qint64> > ranges;
+	for (set<int>::iterator it = visited.begin(); it != visited.end(); ++it) {
+		qint64 offset = objects[*it];
+		ranges.push_back(make_pair(offset, object_ends[offset] - offset));
+	}
+	if (!fetch(ranges)) {
+		return false;
+	}
+	fetched_pages.insert(page);
+	return true;
+}
+
+bool RangeSource::has_page(int page) {
+	QMutexLocker locker(&mutex);
+	return fetched_pages.find(page) != fetched_pages.end();
+}
+
+bool RangeSource::fetch(const vector<pair<qint64,qint64> > &ranges) {
+	// missing blocks
+	vector<bool> wanted(blocks.size(), false);
+	for (unsigned int i = 0; i < ranges.size(); i++) {
+		qint64 start = max(ranges[i].first, (qint64) 0);
+		qint64 end = min(ranges[i].first + ranges[i].second, length);
+		for (qint64 b = start / block_size; b * block_size < end; b++) {
+			if (!blocks[b]) {
+				wanted[b] = true;
+			}
+		}
+	}
+
+	// one request per run of blocks, small gaps are fetched along
+	QNetworkAccessManager *manager = get_manager();
+	QEventLoop loop;
+	vector<pair<qint64,QNetworkReply *> > replies;
+	for (qint64 b = 0; b < (qint64) wanted.size(); b++) {
+		if (!wanted[b]) {
+			continue;
+		}
+		qint64 first = b;
+		qint64 last = b;
+		while (b + 1 < (qint64) wanted.size() && (wanted[b + 1] ||
+				(b + 2 < (qint64) wanted.size() && wanted[b + 2]))) {
+			b++;
+			if (wanted[b]) {
+				last = b;
+			}
+		}
+		qint64 start = first * block_size;
+		qint64 end = min((last + 1) * block_size, length) - 1;
+		QNetworkRequest request(url);
+		request.setRawHeader("Range", QString("bytes=%1-%2").arg(start).arg(end).toAscii());
+		QNetworkReply *reply = manager->get(request);
+		QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+		replies.push_back(make_pair(start, reply));
+	}
+
+	bool done = false;
+	while (!done) {
+		done = true;
+		for (unsigned int i = 0; i < replies.size(); i++) {
+			if (!replies[i].second->isFinished()) {
+				done = false;
+			}
+		}
+		if (!done) {
+			loop.exec();
+		}
+	}
+
+	bool ok = true;
+	for (unsigned int i = 0; i < replies.size(); i++) {
+		QNetworkReply *reply = replies[i].second;
+		// a server ignoring the range sends everything with status 200
+		if (reply->error() != QNetworkReply::NoError ||
+				reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+			if (reply->error() != QNetworkReply::NoError) {
+				cerr << reply->errorString().toStdString() << endl;
+			}
+			ok = false;
+			delete reply;
+			continue;
+		}
+		QByteArray data = reply->readAll();
+		delete reply;
+		// written in place, closing the file would make the viewer reload
+		qint64 offset = replies[i].first;
+		if (pwrite(fd, data.constData(), data.size(), offset) != data.size()) {
+			cerr << "pwrite: " << strerror(errno) << endl;
+			ok = false;
+			continue;
+		}
+		// requests start at a block, the last block of the file may be short
+		qint64 data_end = offset + data.size();
+		for (qint64 b = offset / block_size; b < (qint64) blocks.size(); b++) {
+			if (min((b + 1) * block_size, length) > data_end) {
+				break;
+			}
+			blocks[b] = true;
+		}
+	}
+	return ok;
+}
+
+QByteArray RangeSource::read(qint64 offset, qint64 size) {
+	offset = max(offset, (qint64) 0);
+	size = min(size, length - offset);
+	if (size <= 0) {
+		return QByteArray();
+	}
+	QByteArray data(size, '\0');
+	ssize_t bytes = pread(fd, data.data(), size, offset);
+	if (bytes < 0) {
+		cerr << "pread: " << strerror(errno) << endl;
+		return QByteArray();
+	}
+	data.truncate(bytes);
+	return data;
+}
+
+qint64 RangeSource::get_content_length() {
+	QEventLoop loop;
+	QNetworkReply *reply = get_manager()->head(QNetworkRequest(url));
+	QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+	if (!reply->isFinished()) {
+		loop.exec();
+	}
+	qint64 size = -1;
+	if (reply->error() == QNetworkReply::NoError) {
+		QVariant header = reply->header(QNetworkRequest::ContentLengthHeader);
+		if (header.isValid()) {
+			size = header.toLongLong();
+		}
+	}
+	delete reply;
+	return size;
+}
+
+bool RangeSource::parse_xref(qint64 offset) {
+	set<qint64> seen;
+	while (offset >= 0 && offset < length && seen.insert(offset).second) {
+		vector<pair<qint64,qint64> > ranges;
+		ranges.push_back(make_pair(offset, block_size));
+		if (!fetch(ranges)) {
+			return false;
+		}
+		QByteArray head = read(offset, 32);
+		if (!head.startsWith("xref")) {
+			return false; // xref stream
+		}
+
+		// subsections of 20 byte entries until the trailer
+		qint64 pos = offset + 4;
+		QString trailer;
+		while (1) {
+			QString line = QString::fromLatin1(read(pos, 64));
+			QRegExp section("^\\s*(\\d+)\\s+(\\d+)[ \\t]*\\r?\\n?");
+			if (section.indexIn(line) == -1) {
+				QRegExp trailer_start("^\\s*trailer");
+				if (trailer_start.indexIn(line) == -1) {
+					return false;
+				}
+				pos += trailer_start.matchedLength();
+				ranges.clear();
+				ranges.push_back(make_pair(pos, (qint64) 4096));
+				fetch(ranges);
+				trailer = QString::fromLatin1(read(pos, 4096));
+				break;
+			}
+			int first = section.cap(1).toInt();
+			int count = section.cap(2).toInt();
+			pos += section.matchedLength();
+
+			ranges.clear();
+			ranges.push_back(make_pair(pos, (qint64) count * 20));
+			if (!fetch(ranges)) {
+				return false;
+			}
+			QByteArray entries = read(pos, (qint64) count * 20);
+			for (int i = 0; i < count && (i + 1) * 20 <= entries.size(); i++) {
+				const char *entry = entries.constData() + i * 20;
+				// newer sections are parsed first and win
+				if (entry[17] == 'n' && objects.find(first + i) == objects.end()) {
+					objects[first + i] = strtoll(entry, NULL, 10);
+				}
+			}
+			pos += (qint64) count * 20;
+		}
+		object_ends[offset] = pos;
+
+		int end = trailer.indexOf("startxref");
+		if (end != -1) {
+			trailer.truncate(end);
+		}
+		// hybrid files keep some objects in streams only listed there
+		if (trailer.indexOf("/XRefStm") != -1) {
+			return false;
+		}
+		QRegExp root_ref("/Root\\s+(\\d+)\\s+\\d+\\s+R");
+		if (root == -1 && root_ref.indexIn(trailer) != -1) {
+			root = root_ref.cap(1).toInt();
+		}
+		QRegExp prev("/Prev\\s+(\\d+)");
+		if (prev.indexIn(trailer) == -1) {
+			break;
+		}
+		offset = prev.cap(1).toLongLong();
+	}
+	return root != -1 && objects.find(root) != objects.end();
+}
+
+QByteArray RangeSource::read_object(int object, bool dict_only) {
+	map<int,qint64>::iterator it = objects.find(object);
+	if (it == objects.end()) {
+		return QByteArray();
+	}
+	qint64 size = object_ends[it->second] - it->second;
+	if (dict_only) {
+		size = min(size, dict_size);
+	}
+	vector<pair<qint64,qint64> > ranges;
+	ranges.push_back(make_pair(it->second, size));
+	fetch(ranges);
+	return read(it->second, size);
+}
+
+bool RangeSource::parse_page_tree(int object, int depth) {
+	if (depth > 64 || !tree.insert(object).second) {
+		return false; // broken or cyclic
+	}
+	QString dict = get_dict(read_object(object, true));
+	QRegExp kids("/Kids\\s*\\[([^\\]]*)\\]");
+	if (kids.indexIn(dict) == -1) {
+		pages.push_back(object);
+		return true;
+	}
+	vector<int> refs;
+	find_references(kids.cap(1), refs);
+	for (unsigned int i = 0; i < refs.size(); i++) {
+		if (!parse_page_tree(refs[i], depth + 1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void RangeSource::close() {
+	sources_mutex.lock();
+	sources.erase(file);
+	sources_mutex.unlock();
+	if (fd != -1) {
+		::close(fd);
+		unlink(QFile::encodeName(file).constData());
+		fd = -1;
+	}
+}
+
@@ -0,0 +1,66 @@
+#ifndef RANGESOURCE_H
+#define RANGESOURCE_H
+
+#include <QString>
+#include <QUrl>
+#include <QByteArray>
+#include <QMutex>
+#include <map>
+#include <set>
+#include <vector>
+
+
+// a remote document behind a sparse local file that is filled on demand
+// with http range requests, so only the viewed pages are downloaded
+// poppler can only read files, so the bytes a page needs are fetched
+// before it is rendered; this requires classic xref tables, documents with
+// xref streams (PDF 1.5 object streams) have to be downloaded completely
+class RangeSource {
+public:
+	RangeSource();
+	~RangeSource();
+
+	// returns false if the server or the document doesn't support it
+	bool open(const QString &url, qint64 min_size);
+	const QString &get_file() const;
+
+	// the source backing a local file, NULL for normal files
+	static RangeSource *find(const QString &file);
+
+	// blocks until everything needed to render the page is there
+	bool fetch_page(int page);
+	bool has_page(int page);
+
+private:
+	RangeSource(const RangeSource &other);
+	RangeSource &operator=(const RangeSource &other);
+
+	// expect the mutex to be locked
+	bool fetch(const std::vector<std::pair<qint64,qint64> > &ranges);
+	QByteArray read(qint64 offset, qint64 length);
+	qint64 get_content_length();
+	bool parse_xref(qint64 offset);
+	QByteArray read_object(int object, bool dict_only);
+	bool parse_page_tree(int object, int depth);
+	void close();
+
+	QUrl url;
+	QString file;
+	int fd;
+	qint64 length;
+
+	QMutex mutex;
+	std::vector<bool> blocks; // fetched blocks
+	std::map<int,qint64> objects; // object number -> offset
+	std::map<qint64,qint64> object_ends; // offset -> end of the object
+	int root;
+	std::vector<int> pages; // page object numbers
+	std::set<int> tree; // page tree nodes and pages, not followed for a page
+	std::set<int> fetched_pages;
+
+	static QMutex sources_mutex;
+	static std::map<QString,RangeSource *> sources;
+};
+
+#endif
+
@@ -0,0 +1,242 @@
+#include "rasterizer.h"
+#include "resourcemanager.h"
+#include "documentpool.h"
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+
+//==[ RasterOptions ]==========================================================
+RasterOptions::RasterOptions() :
+		first_page(0),
+		last_page(-1),
+		dpi(72.0f),
+		width(0),
+		rotation(0),
+		inverted_colors(false),
+		output("page-%d.png"),
+		jobs(QThread::idealThreadCount()) {
+}
+
+
+//==[ RasterThread ]===========================================================
+RasterThread::RasterThread(Rasterizer *r) :
+		r(r),
+		doc(NULL) {
+}
+
+RasterThread::~RasterThread() {
+	r->pool->release(doc);
+}
+
+void RasterThread::run() {
+	doc = r->pool->acquire();
+	if (doc == NULL || doc->isLocked()) {
+		cerr << "failed to open document" << endl;
+		// keep taking pages, the stream would wait for them forever
+	} else {
+		ResourceManager::apply_render_hints(doc, false);
+	}
+
+	int page;
+	while (r->take_page(page)) {
+		Poppler::Page *p = NULL;
+		if (doc != NULL && !doc->isLocked()) {
+			p = doc->page(page);
+		}
+		if (p == NULL) {
+			cerr << "failed to load page " << page << endl;
+			r->put_page(page, QImage(), false);
+			continue;
+		}
+
+		float dpi = r->options.dpi;
+		if (r->options.width > 0) {
+			// width of the output, rotated by 90 or 270 degrees that's the page's height
+			QSizeF size = p->pageSizeF();
+			float page_width = r->options.rotation % 2 == 0 ? size.width() : size.height();
+			dpi = 72.0f * r->options.width / page_width;
+		}
+		QImage img = p->renderToImage(dpi, dpi, -1, -1, -1, -1,
+				static_cast<Poppler::Page::Rotation>(r->options.rotation));
+		delete p;
+		if (img.isNull()) {
+			cerr << "failed to render page " << page << endl;
+			r->put_page(page, img, false);
+			continue;
+		}
+		if (r->options.inverted_colors) {
+			img.invertPixels();
+		}
+
+		// encoding is expensive, do it here unless the pages must be in order
+		bool ok = true;
+		if (r->options.output != "-") {
+			QString file = QString(r->options.output).replace("%d", QString::number(page + 1));
+			ok = img.save(file);
+			if (!ok) {
+				cerr << "failed to write " << file.toUtf8().constData() << endl;
+			}
+			img = QImage();
+		}
+		r->put_page(page, img, ok);
+	}
+}
+
+
+//==[ Rasterizer ]=============================================================
+Rasterizer::Rasterizer(const QString &file, const QByteArray &password,
+		const RasterOptions &options) :
+		pool(new DocumentPool(file, password)),
+		options(options),
+		page_count(0),
+		next_page(0),
+		next_frame(0),
+		failed(false) {
+	// the first thread gets this document back
+	Poppler::Document *doc = pool->acquire();
+	if (doc == NULL || doc->isLocked()) {
+		cerr << "failed to open document" << endl;
+		pool->release(doc);
+		return;
+	}
+	int pages = doc->numPages();
+	pool->release(doc);
+
+	if (this->options.rotation < 0 || this->options.rotation > 3) {
+		cerr << "invalid rotation" << endl;
+		return;
+	}
+	if (this->options.first_page < 0 || this->options.first_page >= pages) {
+		cerr << "first page " << this->options.first_page + 1
+			<< " out of range, the document has " << pages << " pages" << endl;
+		return;
+	}
+	if (this->options.last_page < 0 || this->options.last_page >= pages) {
+		this->options.last_page = pages - 1;
+	}
+	if (this->options.last_page < this->options.first_page) {
+		cerr << "last page before first page" << endl;
+		return;
+	}
+	// all threads would write the same file
+	if (this->options.output != "-" && !this->options.output.contains("%d") &&
+			this->options.last_page > this->options.first_page) {
+		cerr << "output pattern needs %d for more than one page" << endl;
+		return;
+	}
+	if (this->options.jobs < 1) {
+		this->options.jobs = 1;
+	}
+	page_count = pages;
+	next_page = next_frame = this->options.first_page;
+}
+
+Rasterizer::~Rasterizer() {
+	Q_FOREACH(RasterThread *t, threads) {
+		t->wait();
+		delete t;
+	}
+	pool->deref();
+}
+
+bool Rasterizer::is_valid() const {
+	return page_count > 0;
+}
+
+int Rasterizer::get_page_count() const {
+	return page_count;
+}
+
+bool Rasterizer::run() {
+	if (!is_valid()) {
+		return false;
+	}
+	int count = options.last_page - options.first_page + 1;
+	for (int i = 0; i < options.jobs && i < count; i++) {
+		RasterThread *t = new RasterThread(this);
+		threads.push_back(t);
+		t->start();
+	}
+
+	mutex.lock();
+	if (options.output == "-") {
+		// stream in page order
+		while (next_frame <= options.last_page) {
+			map<int,QImage>::iterator it = frames.find(next_frame);
+			if (it == frames.end()) {
+				page_done.wait(&mutex);
+				continue;
+			}
+			QImage img = it->second;
+			frames.erase(it);
+			next_frame++;
+			page_written.wakeAll();
+
+			mutex.unlock();
+			if (!img.isNull() && !write_frame(img)) {
+				cerr << "failed to write to stdout" << endl;
+				mutex.lock();
+				failed = true;
+				// let the threads run out
+				next_page = options.last_page + 1;
+				next_frame = options.last_page + 1;
+				page_written.wakeAll();
+				break;
+			}
+			mutex.lock();
+		}
+	}
+	mutex.unlock();
+
+	Q_FOREACH(RasterThread *t, threads) {
+		t->wait();
+		delete t;
+	}
+	threads.clear();
+	return !failed;
+}
+
+bool Rasterizer::take_page(int &page) {
+	mutex.lock();
+	// bound the memory held by pages waiting for the stream
+	while (options.output == "-" && next_page <= options.last_page &&
+			next_page - next_frame >= 2 * options.jobs) {
+		page_written.wait(&mutex);
+	}
+	if (next_page > options.last_page) {
+		mutex.unlock();
+		return false;
+	}
+	page = next_page++;
+	mutex.unlock();
+	return true;
+}
+
+void Rasterizer::put_page(int page, const QImage &img, bool ok) {
+	mutex.lock();
+	if (!ok) {
+		failed = true;
+	}
+	if (options.output == "-" && page >= next_frame) {
+		frames[page] = img; // null images are skipped
+		page_done.wakeAll();
+	}
+	mutex.unlock();
+}
+
+bool Rasterizer::write_frame(const QImage &img) const {
+	// binary PPM, self-delimiting frames that can be concatenated
+	QImage rgb = img.convertToFormat(QImage::Format_RGB888);
+	if (fprintf(stdout, "P6\n%d %d\n255\n", rgb.width(), rgb.height()) < 0) {
+		return false;
+	}
+	for (int y = 0; y < rgb.height(); y++) {
+		if (fwrite(rgb.constScanLine(y), 3, rgb.width(), stdout) != (size_t) rgb.width()) {
+			return false;
+		}
+	}
+	return fflush(stdout) == 0;
+}
+
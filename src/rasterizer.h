@@ -0,0 +1,88 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <poppler/qt4/poppler-qt4.h>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QImage>
+#include <QList>
+#include <map>
+
+
+class Rasterizer;
+class DocumentPool;
+
+
+class RasterOptions {
+public:
+	RasterOptions();
+
+	int first_page; // 0 indexed, inclusive
+	int last_page; // -1 means the last page of the document
+	float dpi;
+	int width; // pixels, overrides dpi if > 0
+	int rotation; // 0..3, clockwise
+	bool inverted_colors;
+	QString output; // file name with %d for the page number, "-" streams PPM frames to stdout
+	int jobs;
+};
+
+
+// renders with a document of its own, poppler documents can't be shared between threads
+class RasterThread : public QThread {
+	Q_OBJECT
+
+public:
+	RasterThread(Rasterizer *r);
+	~RasterThread();
+
+	void run();
+
+private:
+	Rasterizer *r;
+	Poppler::Document *doc;
+};
+
+
+// renders page ranges without a viewer, spread across several threads
+class Rasterizer {
+public:
+	Rasterizer(const QString &file, const QByteArray &password, const RasterOptions &options);
+	~Rasterizer();
+
+	// false if the document can't be opened or the options don't fit it,
+	// the reason is printed
+	bool is_valid() const;
+	int get_page_count() const;
+
+	// blocks until all pages are written, returns false if any page failed
+	bool run();
+
+private:
+	friend class RasterThread;
+
+	// for the render threads
+	bool take_page(int &page);
+	void put_page(int page, const QImage &img, bool ok);
+
+	bool write_frame(const QImage &img) const;
+
+	DocumentPool *pool;
+	RasterOptions options;
+	int page_count;
+
+	QMutex mutex;
+	QWaitCondition page_done;
+	QWaitCondition page_written;
+	int next_page; // next page to render
+	int next_frame; // next page to stream to stdout
+	std::map<int,QImage> frames; // rendered but not yet streamed
+	bool failed;
+
+	QList<RasterThread *> threads;
+};
+
+#endif
+
@@ -3,7 +3,10 @@
 #include <cerrno>
 #include <unistd.h>
 #include <QSocketNotifier>
+#include <QFile>
 #include <QFileInfo>
+#include <QPainter>
+#include <QTime>
 #ifdef __linux__
 #include <sys/inotify.h>
 #endif
@@ -11,8 +14,15 @@
 #include "canvas.h"
 #include "config.h"
 #include "util.h"
+#include "stats.h"
+#include "trace.h"
 #include "kpage.h"
 #include "worker.h"
+#include "atlas.h"
+#include "shmcache.h"
+#include "rangesource.h"
+#include "documentloader.h"
+#include "documentpool.h"
 #include "viewer.h"
 #include "beamerwindow.h"
 #include "selection.h"
@@ -24,29 +34,75 @@ using namespace std;
 ResourceManager::ResourceManager(const QString &file, Viewer *v) :
 		viewer(v),
 		file(file),
+		file_switched(false),
 		doc(NULL),
 		center_page(0),
 		rotation(0),
+		generation(0),
+		fast_rendering(false),
 #ifdef __linux__
 		i_notifier(NULL),
 #endif
+		reload_size(-1),
+		reload_checks(0),
+		reload_loader(NULL),
+		reload_pending(false),
 		inverted_colors(false),
 		cur_jump_pos(jumplist.end()) {
 	// load config options
 	CFG *config = CFG::get_instance();
 	smooth_downscaling = config->get_value("Settings/thumbnail_filter").toBool();
 	thumbnail_size = config->get_value("Settings/thumbnail_size").toInt();
+	overview_page_size = config->get_value("Settings/overview_page_size").toInt();
+	overview_tile_pages = config->get_value("Settings/overview_tile_pages").toInt();
+	fast_while_scrolling = config->get_value("Settings/fast_render_while_scrolling").toBool();
+	direct_render = config->get_value("Settings/direct_render").toBool();
+	direct_render_max_time = config->get_value("Settings/direct_render_max_time").toInt();
+	prefetch_max_time = config->get_value("Settings/prefetch_max_time").toInt();
+	shared_cache_size = config->get_value("Settings/shared_cache_size").toInt();
+
+	idle_timer.setSingleShot(true);
+	idle_timer.setInterval(config->get_value("Settings/quality_render_delay").toInt());
+	connect(&idle_timer, SIGNAL(timeout()), this, SLOT(idle_slot()));
+
+	reload_timer.setSingleShot(true);
+	reload_timer.setInterval(config->get_value("Settings/reload_delay").toInt());
+	connect(&reload_timer, SIGNAL(timeout()), this, SLOT(check_reload()));
 
 	initialize(file, QByteArray());
 }
 
-void ResourceManager::initialize(const QString &file, const QByteArray &password) {
+void ResourceManager::initialize(const QString &file, const QByteArray &password, DocumentLoader *loaded) {
 	page_count = 0;
+	generation++;
 	k_page = NULL;
+	atlas = NULL;
+	shm_cache = NULL;
+	range_source = RangeSource::find(file);
+	pool = NULL;
+
+	direct_doc = NULL;
+	direct_load_failed = false;
+	this->password = password;
 
 	doc = NULL;
 	if (!file.isNull()) {
-		doc = Poppler::Document::load(file, QByteArray(), password);
+		// the background parse left its document in the pool
+		if (loaded != NULL) {
+			pool = loaded->take_pool();
+		}
+		if (pool == NULL) {
+			pool = new DocumentPool(file, password);
+		}
+		doc = pool->acquire();
+
+		if (shared_cache_size > 0 && doc != NULL && !doc->isLocked()) {
+			shm_cache = new ShmCache(file, shared_cache_size);
+			if (!shm_cache->is_valid()) {
+				delete shm_cache;
+				shm_cache = NULL;
+			}
+		}
 	}
 
 	worker = new Worker(this);
@@ -85,33 +141,34 @@ void ResourceManager::initialize(const QString &file, const QByteArray &password
 //		cerr << "missing password" << endl;
 		return;
 	}
-	doc->setRenderHint(Poppler::Document::Antialiasing, true);
-	doc->setRenderHint(Poppler::Document::TextAntialiasing, true);
-	doc->setRenderHint(Poppler::Document::TextHinting, true);
-#if POPPLER_VERSION >= POPPLER_VERSION_CHECK(0, 18, 0)
-	doc->setRenderHint(Poppler::Document::TextSlightHinting, true);
-#endif
-#if POPPLER_VERSION >= POPPLER_VERSION_CHECK(0, 22, 0)
-//	doc->setRenderHint(Poppler::Document::OverprintPreview, true); // TODO what is this?
-#endif
-#if POPPLER_VERSION >= POPPLER_VERSION_CHECK(0, 24, 0)
-	doc->setRenderHint(Poppler::Document::ThinLineSolid, true); // TODO what's the difference between ThinLineSolid and ThinLineShape?
-#endif
+	set_render_hints(false);
 
 	page_count = doc->numPages();
 
 	min_aspect = numeric_limits<float>::max();
 	max_aspect = numeric_limits<float>::min();
 
+	// sizes from the background parse, if it saw the same document
+	const QVector<QSizeF> *sizes = NULL;
+	if (loaded != NULL && loaded->is_valid() && loaded->get_page_sizes().size() == page_count) {
+		sizes = &loaded->get_page_sizes();
+	}
+
 	k_page = new KPage[get_page_count()];
 	for (int i = 0; i < get_page_count(); i++) {
-		Poppler::Page *p = doc->page(i);
-		if (p == NULL) {
-			cerr << "failed to load page " << i << endl;
-			continue;
+		if (sizes != NULL) {
+			k_page[i].width = sizes->at(i).width();
+			k_page[i].height = sizes->at(i).height();
+		} else {
+			Poppler::Page *p = doc->page(i);
+			if (p == NULL) {
+				cerr << "failed to load page " << i << endl;
+				continue;
+			}
+			k_page[i].width = p->pageSizeF().width();
+			k_page[i].height = p->pageSizeF().height();
+			delete p;
 		}
-		k_page[i].width = p->pageSizeF().width();
-		k_page[i].height = p->pageSizeF().height();
 
 		float aspect = k_page[i].width / k_page[i].height;
 		if (aspect < min_aspect) {
@@ -125,10 +182,41 @@ void ResourceManager::initialize(const QString &file, const QByteArray &password
 //		if (k_page[i].label != QString::number(i + 1)) {
 //			cout << i << endl;
 //		}
-		delete p;
+	}
+
+	if (overview_page_size > 0) {
+		atlas = new Atlas(file, pool, page_count, overview_page_size, overview_tile_pages);
+		if (viewer->get_canvas() != NULL) {
+			connect(atlas, SIGNAL(page_rendered(int)), viewer->get_canvas(), SLOT(page_rendered(int)), Qt::UniqueConnection);
+		}
+		atlas->start(QThread::LowPriority);
 	}
 }
 
+DocumentPool *ResourceManager::get_document_pool() const {
+	return pool;
+}
+
+void ResourceManager::set_render_hints(bool fast) {
+	apply_render_hints(doc, fast);
+}
+
+void ResourceManager::apply_render_hints(Poppler::Document *doc, bool fast) {
+	// the fast profile skips antialiasing and hinting, which dominate on complex vector pages
+	doc->setRenderHint(Poppler::Document::Antialiasing, !fast);
+	doc->setRenderHint(Poppler::Document::TextAntialiasing, !fast);
+	doc->setRenderHint(Poppler::Document::TextHinting, !fast);
+#if POPPLER_VERSION >= POPPLER_VERSION_CHECK(0, 18, 0)
+	doc->setRenderHint(Poppler::Document::TextSlightHinting, !fast);
+#endif
+#if POPPLER_VERSION >= POPPLER_VERSION_CHECK(0, 22, 0)
+//	doc->setRenderHint(Poppler::Document::OverprintPreview, true); // TODO what is this?
+#endif
+#if POPPLER_VERSION >= POPPLER_VERSION_CHECK(0, 24, 0)
+	doc->setRenderHint(Poppler::Document::ThinLineSolid, true); // TODO what's the difference between ThinLineSolid and ThinLineShape?
+#endif
+}
+
 ResourceManager::~ResourceManager() {
 	shutdown();
 }
@@ -137,24 +225,95 @@ void ResourceManager::shutdown() {
 	if (worker != NULL) {
 		join_threads();
 	}
+	delete atlas;
+	atlas = NULL;
 	garbageMutex.lock();
 	garbage.clear();
 	garbageMutex.unlock();
+	pinned.clear();
 	requests.clear();
+	prefetch_requests.clear();
 	requestSemaphore.acquire(requestSemaphore.available());
 #ifdef __linux__
 	::close(inotify_fd);
 	delete i_notifier;
 	i_notifier = NULL;
 #endif
-	delete doc;
+	reload_timer.stop();
+	if (reload_loader != NULL) {
+		// poppler can't be interrupted, let it finish on its own
+		disconnect(reload_loader, SIGNAL(finished()), this, SLOT(reload_parsed()));
+		reload_loader->detach();
+		reload_loader = NULL;
+	}
+	reload_pending = false;
+	if (pool != NULL) {
+		pool->release(doc);
+		pool->release(direct_doc);
+		pool->deref();
+		pool = NULL;
+	}
+	doc = NULL;
+	direct_doc = NULL;
+	delete shm_cache;
+	shm_cache = NULL;
+	// the images go away with the pages
+	for (int i = 0; i < get_page_count(); i++) {
+		for (int j = 0; j < 3; j++) {
+			Stats::get_instance()->add_image_bytes(-k_page[i].img[j].byteCount());
+		}
+	}
 	delete[] k_page;
 	delete worker;
 }
 
-void ResourceManager::load(const QString &file, const QByteArray &password) {
+void ResourceManager::load(const QString &file, const QByteArray &password, DocumentLoader *loaded) {
+	// the old renderings stay visible until the pages are rendered again
+	vector<KPage *> placeholders;
+	bool keep = !file_switched && k_page != NULL;
+	file_switched = false;
+	if (keep) {
+		if (worker != NULL) {
+			join_threads(); // no more writes to the images
+		}
+		for (int i = 0; i < get_page_count(); i++) {
+			KPage *old = new KPage();
+			old->width = k_page[i].width;
+			old->height = k_page[i].height;
+			old->inverted_colors = k_page[i].inverted_colors;
+			for (int j = 0; j < 3; j++) {
+				old->img[j] = k_page[i].img[j]; // shallow copy
+				old->rotation[j] = k_page[i].rotation[j];
+			}
+			placeholders.push_back(old);
+		}
+	}
+
 	shutdown();
-	initialize(file, password);
+	initialize(file, password, loaded);
+
+	for (unsigned int i = 0; i < placeholders.size(); i++) {
+		KPage *old = placeholders[i];
+		// only pages that kept their size
+		if ((int) i < get_page_count() &&
+				old->width == k_page[i].width && old->height == k_page[i].height) {
+			k_page[i].inverted_colors = old->inverted_colors;
+			bool used = false;
+			for (int j = 0; j < 3; j++) {
+				k_page[i].img[j] = old->img[j];
+				k_page[i].rotation[j] = old->rotation[j];
+				k_page[i].status[j] = -1; // never matches, gets rendered again
+				Stats::get_instance()->add_image_bytes(old->img[j].byteCount());
+				used = used || !old->img[j].isNull();
+			}
+			if (used) {
+				garbageMutex.lock();
+				garbage.insert(i);
+				garbageMutex.unlock();
+			}
+		}
+		delete old;
+	}
 }
 
 bool ResourceManager::is_valid() const {
@@ -173,6 +332,9 @@ const QString &ResourceManager::get_file() const {
 }
 
 void ResourceManager::set_file(const QString &new_file) {
+	if (new_file != file) {
+		file_switched = true;
+	}
 	file = new_file;
 }
 
@@ -185,8 +347,12 @@ const KPage *ResourceManager::get_page(int page, int width, int index) {
 	k_page[page].mutex.lock();
 	if (k_page[page].img[index].isNull() ||
 			k_page[page].status[index] != width ||
-			k_page[page].rotation[index] != rotation) {
+			k_page[page].rotation[index] != rotation ||
+			(k_page[page].fast[index] && !fast_rendering)) {
+		Stats::get_instance()->record_cache(false);
 		enqueue(page, width, index);
+	} else {
+		Stats::get_instance()->record_cache(true);
 	}
 	if (inverted_colors != k_page[page].inverted_colors) {
 		k_page[page].inverted_colors = inverted_colors;
@@ -198,6 +364,124 @@ const KPage *ResourceManager::get_page(int page, int width, int index) {
 	return &k_page[page];
 }
 
+void ResourceManager::prefetch(int page, int width, int index) {
+	if (page < 0 || page >= get_page_count()) {
+		return;
+	}
+
+	k_page[page].mutex.lock();
+	bool missing = k_page[page].img[index].isNull() ||
+			k_page[page].status[index] != width ||
+			k_page[page].rotation[index] != rotation ||
+			(k_page[page].fast[index] && !fast_rendering);
+	k_page[page].mutex.unlock();
+	if (!missing) {
+		return;
+	}
+
+	// pinned is only used by the gui thread, like prefetch
+	bool exact = pinned.find(page) != pinned.end();
+	RenderRequest request = {index, width, estimate_render_time(page, width), exact};
+	requestMutex.lock();
+	// already requested with normal priority
+	if (requests.find(page) == requests.end()) {
+		map<int,RenderRequest>::iterator it = prefetch_requests.find(page);
+		if (it == prefetch_requests.end()) {
+			prefetch_requests[page] = request;
+			requestSemaphore.release(1);
+		} else if (index <= it->second.index) {
+			it->second = request;
+		}
+	}
+	requestMutex.unlock();
+}
+
+bool ResourceManager::render_overview(QPainter *painter, int page, const QRect &rect) {
+	if (atlas == NULL) {
+		return false;
+	}
+	return atlas->draw_page(painter, page, rect, rotation, inverted_colors);
+}
+
+void ResourceManager::prefetch_overview(int page) {
+	if (atlas == NULL) {
+		return;
+	}
+	atlas->request(page, inverted_colors);
+}
+
+bool ResourceManager::render_direct(QPainter *painter, int page, const QRect &rect) {
+#if POPPLER_VERSION >= POPPLER_VERSION_CHECK(0, 16, 0)
+	// vector output can't be inverted cheaply
+	if (!direct_render || inverted_colors || page < 0 || page >= get_page_count()) {
+		return false;
+	}
+	k_page[page].mutex.lock();
+	int time = k_page[page].render_time;
+	k_page[page].mutex.unlock();
+	// unknown or too expensive to paint on every redraw
+	if (time < 0 || time > direct_render_max_time) {
+		return false;
+	}
+
+	// never wait for the network while painting
+	if (range_source != NULL && !range_source->has_page(page)) {
+		return false;
+	}
+
+	// the worker's document uses the splash backend and belongs to its thread
+	if (direct_doc == NULL) {
+		if (direct_load_failed) {
+			return false;
+		}
+		direct_doc = pool->acquire();
+		if (direct_doc == NULL || direct_doc->isLocked()) {
+			pool->release(direct_doc);
+			direct_doc = NULL;
+			direct_load_failed = true;
+			return false;
+		}
+		direct_doc->setRenderBackend(Poppler::Document::ArthurBackend);
+		direct_doc->setRenderHint(Poppler::Document::Antialiasing, true);
+		direct_doc->setRenderHint(Poppler::Document::TextAntialiasing, true);
+	}
+	Poppler::Page *p = direct_doc->page(page);
+	if (p == NULL) {
+		return false;
+	}
+
+	QTime timer;
+	timer.start();
+	float dpi = 72.0 * rect.width() / get_page_width(page);
+	painter->save();
+	painter->fillRect(rect, Qt::white);
+	painter->setClipRect(rect);
+	painter->translate(rect.topLeft());
+	bool ok = p->renderToPainter(painter, dpi, dpi, -1, -1, -1, -1,
+			static_cast<Poppler::Page::Rotation>(rotation));
+	painter->restore();
+	delete p;
+
+	// falls back to the raster cache if painting turned out to be slow
+	k_page[page].mutex.lock();
+	k_page[page].render_time = timer.elapsed();
+	k_page[page].mutex.unlock();
+	return ok;
+#else
+	Q_UNUSED(painter);
+	Q_UNUSED(page);
+	Q_UNUSED(rect);
+	return false;
+#endif
+}
+
+int ResourceManager::get_overview_page_size() const {
+	if (atlas == NULL) {
+		return 0;
+	}
+	return overview_page_size;
+}
+
 int ResourceManager::get_rotation() const {
 	return rotation;
 }
@@ -219,11 +503,30 @@ void ResourceManager::invert_colors() {
 	inverted_colors = !inverted_colors;
 }
 
+void ResourceManager::interaction() {
+	if (!fast_while_scrolling) {
+		return;
+	}
+	fast_rendering = true;
+	idle_timer.start();
+}
+
+void ResourceManager::idle_slot() {
+	fast_rendering = false;
+	// visible pages request their quality version on redraw
+	viewer->get_canvas()->update();
+	viewer->get_beamer()->update();
+}
+
 bool ResourceManager::are_colors_inverted() const {
 	return inverted_colors;
 }
 
 void ResourceManager::collect_garbage(int keep_min, int keep_max) {
+	TraceScope scope("collect_garbage");
+	if (atlas != NULL) {
+		atlas->collect_garbage(keep_min, keep_max);
+	}
 	requestMutex.lock();
 	center_page = (keep_min + keep_max) / 2;
 	requestMutex.unlock();
@@ -231,7 +534,7 @@ void ResourceManager::collect_garbage(int keep_min, int keep_max) {
 	garbageMutex.lock();
 	for (set<int>::iterator it = garbage.begin(); it != garbage.end(); /* empty */) {
 		int page = *it;
-		if (page >= keep_min && page <= keep_max) {
+		if ((page >= keep_min && page <= keep_max) || pinned.find(page) != pinned.end()) {
 			++it; // move on
 			continue;
 		}
@@ -266,9 +569,11 @@ void ResourceManager::collect_garbage(int keep_min, int keep_max) {
 			}
 		}
 		for (int i = 0; i < 3; i++) {
+			Stats::get_instance()->add_image_bytes(-k_page[page].img[i].byteCount());
 			k_page[page].img[i] = QImage();
 			k_page[page].status[i] = 0;
 			k_page[page].rotation[i] = 0;
+			k_page[page].fast[i] = false;
 		}
 		k_page[page].mutex.unlock();
 	}
@@ -279,20 +584,52 @@ void ResourceManager::collect_garbage(int keep_min, int keep_max) {
 		return;
 	}
 	requestMutex.lock();
-	for (map<int,pair<int,int> >::iterator it = requests.begin(); it != requests.end(); ) {
-		if (it->first < keep_min || it->first > keep_max) {
+	for (map<int,RenderRequest>::iterator it = requests.begin(); it != requests.end(); ) {
+		if ((it->first < keep_min || it->first > keep_max) && pinned.find(it->first) == pinned.end()) {
 			requestSemaphore.acquire(1);
 			requests.erase(it++);
 		} else {
 			++it;
 		}
 	}
+	for (map<int,RenderRequest>::iterator it = prefetch_requests.begin(); it != prefetch_requests.end(); ) {
+		if ((it->first < keep_min || it->first > keep_max) && pinned.find(it->first) == pinned.end()) {
+			requestSemaphore.acquire(1);
+			prefetch_requests.erase(it++);
+		} else {
+			++it;
+		}
+	}
 	requestMutex.unlock();
 }
 
+int ResourceManager::get_queue_length(bool visible_only) {
+	requestMutex.lock();
+	int length = requests.size();
+	if (!visible_only) {
+		length += prefetch_requests.size();
+	}
+	requestMutex.unlock();
+	return length;
+}
+
+int ResourceManager::get_overview_queue_length() {
+	if (atlas == NULL) {
+		return 0;
+	}
+	return atlas->get_queue_length();
+}
+
+void ResourceManager::set_pinned(const set<int> &pages) {
+	pinned = pages;
+}
+
 void ResourceManager::connect_canvas() const {
 	connect(worker, SIGNAL(page_rendered(int)), viewer->get_canvas(), SLOT(page_rendered(int)), Qt::UniqueConnection);
 	connect(worker, SIGNAL(page_rendered(int)), viewer->get_beamer(), SLOT(page_rendered(int)), Qt::UniqueConnection);
+	if (atlas != NULL) {
+		connect(atlas, SIGNAL(page_rendered(int)), viewer->get_canvas(), SLOT(page_rendered(int)), Qt::UniqueConnection);
+	}
 }
 
 void ResourceManager::store_jump(int page) {
@@ -362,10 +699,11 @@ void ResourceManager::inotify_slot() {
 			struct inotify_event *event = reinterpret_cast<struct inotify_event *>(&buf[offset]);
 
 			QFileInfo info(file);
-			if (info.fileName() == event->name) {
-				viewer->reload(false); // don't clamp
-				i_notifier->setEnabled(true);
-				return;
+			if (event->len > 0) {
+				if (info.fileName() == event->name) {
+					schedule_reload();
+				}
+				emit file_changed(QFile::decodeName(event->name));
 			}
 
 			offset += sizeof(struct inotify_event) + event->len;
@@ -376,15 +714,88 @@ void ResourceManager::inotify_slot() {
 #endif
 }
 
+// pdf readers accept the marker anywhere in the last 1024 bytes
+static bool has_eof_marker(const QString &file) {
+	QFile f(file);
+	if (!f.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	if (f.size() > 1024) {
+		f.seek(f.size() - 1024);
+	}
+	return f.read(1024).contains("%%EOF");
+}
+
+void ResourceManager::schedule_reload() {
+	reload_size = QFileInfo(file).size();
+	reload_checks = 0;
+	// restarting delays the reload until the writes stop
+	reload_timer.start();
+}
+
+void ResourceManager::check_reload() {
+	if (reload_loader != NULL) {
+		reload_pending = true;
+		return;
+	}
+
+	// still being written, or not completely; the next close triggers again
+	QFileInfo info(file);
+	if (!info.exists() || info.size() != reload_size || !has_eof_marker(file)) {
+		reload_size = info.size();
+		if (++reload_checks < 20) {
+			reload_timer.start();
+		}
+		return;
+	}
+
+	// a broken file must not replace the shown one
+	reload_loader = new DocumentLoader(file, password);
+	connect(reload_loader, SIGNAL(finished()), this, SLOT(reload_parsed()), Qt::UniqueConnection);
+	reload_loader->start(QThread::LowPriority);
+}
+
+void ResourceManager::reload_parsed() {
+	// queued before the loader was detached
+	if (sender() != reload_loader) {
+		return;
+	}
+	DocumentLoader *loader = reload_loader;
+	reload_loader = NULL;
+
+	if (reload_pending) {
+		// parsed an outdated version
+		reload_pending = false;
+		delete loader;
+		schedule_reload();
+		return;
+	}
+	if (!loader->is_valid()) {
+		cerr << "not reloading, failed to parse " << file.toUtf8().constData() << endl;
+		delete loader;
+		return;
+	}
+	viewer->swap_document(loader, false); // don't clamp
+	delete loader;
+}
+
 void ResourceManager::enqueue(int page, int width, int index) {
+	// estimated outside of requestMutex, the worker holds it while picking
+	RenderRequest request = {index, width, estimate_render_time(page, width), true};
 	requestMutex.lock();
-	map<int,pair<int,int> >::iterator it = requests.find(page);
+	map<int,RenderRequest>::iterator it = requests.find(page);
 	if (it == requests.end()) {
-		requests[page] = make_pair(index, width);
-		requestSemaphore.release(1);
+		// a pending prefetch is needed right now, promote it
+		map<int,RenderRequest>::iterator pre = prefetch_requests.find(page);
+		if (pre != prefetch_requests.end()) {
+			prefetch_requests.erase(pre);
+		} else {
+			requestSemaphore.release(1);
+		}
+		requests[page] = request;
 	} else {
-		if (index <= it->second.first) {
-			it->second = make_pair(index, width);
+		if (index <= it->second.index) {
+			it->second = request;
 		}
 	}
 	requestMutex.unlock();
@@ -448,6 +859,55 @@ int ResourceManager::get_page_count() const {
 	return page_count;
 }
 
+int ResourceManager::estimate_render_time(int page, int width) {
+	if (page < 0 || page >= get_page_count()) {
+		return -1;
+	}
+	int dpi = ROUND(72.0f * width / get_page_width(page));
+	float pixels = (float) width * ROUND(width / get_page_aspect(page));
+
+	costMutex.lock();
+	const map<int,pair<int,int> > &costs = k_page[page].costs;
+	if (costs.empty()) {
+		costMutex.unlock();
+		return -1;
+	}
+	// closest known resolution
+	map<int,pair<int,int> >::const_iterator it = costs.lower_bound(dpi);
+	if (it == costs.end()) {
+		--it;
+	} else if (it != costs.begin()) {
+		map<int,pair<int,int> >::const_iterator less = it;
+		--less;
+		if (dpi - less->first < it->first - dpi) {
+			it = less;
+		}
+	}
+	int time = it->second.first;
+	int known_pixels = it->second.second;
+	costMutex.unlock();
+
+	// rendering time mostly grows with the output size
+	if (known_pixels <= 0) {
+		return time;
+	}
+	return time * pixels / known_pixels;
+}
+
+map<int,pair<int,int> > ResourceManager::get_render_costs(int page) {
+	if (page < 0 || page >= get_page_count()) {
+		return map<int,pair<int,int> >();
+	}
+	costMutex.lock();
+	map<int,pair<int,int> > costs = k_page[page].costs;
+	costMutex.unlock();
+	return costs;
+}
+
+int ResourceManager::get_generation() const {
+	return generation;
+}
+
 const QList<Poppler::Link *> *ResourceManager::get_links(int page) {
 	if (page < 0 || page >= get_page_count()) {
 		return NULL;
@@ -468,13 +928,6 @@ const QList<SelectionLine *> *ResourceManager::get_text(int page) {
 	return t;
 }
 
-QDomDocument *ResourceManager::get_toc() const {
-	if (doc == NULL || doc->isLocked()) {
-		return NULL;
-	}
-	return doc->toc();
-}
-
 void ResourceManager::join_threads() {
 	worker->die = true;
 	requestSemaphore.release(1);
@@ -8,7 +8,9 @@
 #include <QThread>
 #include <QMutex>
 #include <QSemaphore>
+#include <QTimer>
 #include <list>
+#include <map>
 #include <set>
 
 
@@ -16,10 +18,25 @@ class ResourceManager;
 class Canvas;
 class KPage;
 class Worker;
+class Atlas;
+class ShmCache;
+class RangeSource;
+class DocumentLoader;
+class DocumentPool;
 class Viewer;
 class QSocketNotifier;
-class QDomDocument;
 class SelectionLine;
+class QPainter;
+class QRect;
+
+
+// a queued page rendering
+struct RenderRequest {
+	int index;
+	int width;
+	int cost; // estimate_render_time when queued, the worker doesn't recompute it
+	bool exact; // visible or pinned (the beamer's next slide), never reduced or deferred
+};
 
 
 class ResourceManager : public QObject {
@@ -29,7 +46,8 @@ public:
 	ResourceManager(const QString &file, Viewer *v);
 	~ResourceManager();
 
-	void load(const QString &file, const QByteArray &password);
+	// loaded is a finished background parse of file, saves parsing it again
+	void load(const QString &file, const QByteArray &password, DocumentLoader *loaded = NULL);
 
 	// document opened correctly?
 	bool is_valid() const;
@@ -39,6 +57,16 @@ public:
 	void set_file(const QString &new_file);
 	// page (meta)data
 	const KPage *get_page(int page, int newWidth, int index);
+	// like get_page, but queued behind all pages that are actually shown
+	void prefetch(int page, int width, int index = 0);
+	// low resolution version for overviews, false if not available yet
+	bool render_overview(QPainter *painter, int page, const QRect &rect);
+	void prefetch_overview(int page);
+	// paints cheap pages as vectors instead of a cached image
+	// returns false if the page has to come from the raster cache
+	bool render_direct(QPainter *painter, int page, const QRect &rect);
+	// pages up to this size are drawn from the overview, 0 if disabled
+	int get_overview_page_size() const;
 //	QString get_page_label(int page) const;
 	float get_page_width(int page, bool rotated = true) const;
 	float get_page_height(int page, bool rotated = true) const;
@@ -46,17 +74,34 @@ public:
 	float get_min_aspect(bool rotated = true) const;
 	float get_max_aspect(bool rotated = true) const;
 	int get_page_count() const;
+	// learned cost model, expected milliseconds for rendering at this width
+	// -1 if the page was never rendered
+	int estimate_render_time(int page, int width);
+	// measured costs for all resolutions, dpi -> (ms, pixels)
+	// read only, for saving them along with persistent caches
+	std::map<int,std::pair<int,int> > get_render_costs(int page);
+	// changes whenever a document is (re)loaded
+	int get_generation() const;
 	const QList<Poppler::Link *> *get_links(int page);
 	const QList<SelectionLine *> *get_text(int page);
-	QDomDocument *get_toc() const;
+	// documents for other threads, e.g. search; NULL if no file is loaded
+	DocumentPool *get_document_pool() const;
 
 	int get_rotation() const;
 	void rotate(int value, bool relative = true);
 	void unlock_page(int page) const;
 	void invert_colors();
+	// switches to the fast render profile until input goes idle
+	void interaction();
 	bool are_colors_inverted() const;
 
 	void collect_garbage(int keep_min, int keep_max);
+	// number of pages waiting for the worker
+	int get_queue_length(bool visible_only = false);
+	// number of overview tiles waiting for the atlas
+	int get_overview_queue_length();
+	// pages collect_garbage keeps regardless of distance, e.g. upcoming slides
+	void set_pinned(const std::set<int> &pages);
 
 	void connect_canvas() const;
 
@@ -67,31 +112,57 @@ public:
 
 	Poppler::LinkDestination *resolve_link_destination(const QString &name) const;
 
+	// the hints every full rendering uses, also for documents outside the viewer
+	static void apply_render_hints(Poppler::Document *doc, bool fast);
+
+signals:
+	// any file in the document's directory, e.g. the synctex file
+	void file_changed(const QString &name);
+
 public slots:
 	void inotify_slot();
 
+private slots:
+	void idle_slot();
+	// reloads once the changed file is complete and parses
+	void check_reload();
+	void reload_parsed();
+
 private:
 	void enqueue(int page, int width, int index = 0);
 
-	void initialize(const QString &file, const QByteArray &password);
+	void initialize(const QString &file, const QByteArray &password, DocumentLoader *loaded = NULL);
+	void schedule_reload();
+	void set_render_hints(bool fast);
 	void join_threads();
 	void shutdown();
 
 	// sadly, poppler's renderToImage only supports one thread per document
 	Worker *worker;
+	Atlas *atlas;
+	ShmCache *shm_cache; // NULL if disabled
+	RangeSource *range_source; // NULL unless the file is remote and read on demand
 
 	Viewer *viewer;
 
 	QString file;
+	bool file_switched; // old renderings can't serve as placeholders
+	QByteArray password;
+	DocumentPool *pool;
 	Poppler::Document *doc;
+	Poppler::Document *direct_doc; // Arthur backend, gui thread only
+	bool direct_load_failed;
 	QMutex requestMutex;
 	QMutex garbageMutex;
+	QMutex costMutex;
 	QSemaphore requestSemaphore;
 	int center_page;
 	float max_aspect;
 	float min_aspect;
-	std::map<int,std::pair<int,int> > requests; // page, index, width
+	std::map<int,RenderRequest> requests; // by page
+	std::map<int,RenderRequest> prefetch_requests; // lower priority
 	std::set<int> garbage;
+	std::set<int> pinned; // only used by the gui thread
 	QMutex link_mutex;
 
 	KPage *k_page;
@@ -100,6 +171,10 @@ private:
 
 	int page_count;
 	int rotation;
+	int generation;
+
+	volatile bool fast_rendering;
+	QTimer idle_timer;
 
 #ifdef __linux__
 	int inotify_fd;
@@ -107,10 +182,24 @@ private:
 	QSocketNotifier *i_notifier;
 #endif
 
+	// coalesces the writes of e.g. a LaTeX run into one reload
+	QTimer reload_timer;
+	qint64 reload_size; // file size at the last check
+	int reload_checks;
+	DocumentLoader *reload_loader;
+	bool reload_pending; // changed again while parsing
+
 	// config options
 	bool smooth_downscaling;
 	int thumbnail_size;
+	int overview_page_size;
+	int overview_tile_pages;
 	bool inverted_colors;
+	bool fast_while_scrolling;
+	bool direct_render;
+	int direct_render_max_time;
+	int prefetch_max_time;
+	int shared_cache_size;
 
 	std::list<int> jumplist;
 	std::map<int,std::list<int>::iterator> jump_map;
@@ -1,10 +1,15 @@
 #include <iostream>
+#include <QTime>
 #include "search.h"
 #include "canvas.h"
 #include "viewer.h"
 #include "config.h"
 #include "util.h"
 #include "resourcemanager.h"
+#include "stats.h"
+#include "trace.h"
+#include "rangesource.h"
+#include "documentpool.h"
 #include "layout/layout.h"
 
 using namespace std;
@@ -40,6 +45,14 @@ void SearchWorker::run() {
 		forward = bar->forward;
 		bar->term_mutex.unlock();
 
+		// only busy searches hold a document
+		Poppler::Document *doc = bar->pool->acquire();
+		if (doc == NULL || doc->isLocked()) {
+			bar->pool->release(doc);
+			emit update_label_text("failed to open document");
+			continue;
+		}
+
 		// check if term contains upper case letters; if so, do case sensitive search (smartcase)
 		bool has_upper_case = false;
 		for (QString::const_iterator it = search_term.begin(); it != search_term.end(); ++it) {
@@ -58,8 +71,16 @@ void SearchWorker::run() {
 		// search all pages
 		int hit_count = 0;
 		int page = start;
+		int searched = 0;
+		QTime timer;
+		timer.start();
+		Trace::get_instance()->begin("search");
 		do {
-			Poppler::Page *p = bar->doc->page(page);
+			TraceScope scope("search_page", page);
+			if (bar->range_source != NULL) {
+				bar->range_source->fetch_page(page);
+			}
+			Poppler::Page *p = doc->page(page);
 			if (p == NULL) {
 				cerr << "failed to load page " << page << endl;
 				continue;
@@ -93,6 +114,7 @@ void SearchWorker::run() {
 			}
 #endif
 			delete p;
+			searched++;
 
 			// clean up when interrupted
 			if (stop || die) {
@@ -110,11 +132,11 @@ void SearchWorker::run() {
 			// update progress label next to the search bar
 			int percent;
 			if (forward) {
-				percent = page + bar->doc->numPages() - start;
+				percent = page + doc->numPages() - start;
 			} else {
-				percent = start + bar->doc->numPages() - page;
+				percent = start + doc->numPages() - page;
 			}
-			percent = (percent % bar->doc->numPages()) * 100 / bar->doc->numPages();
+			percent = (percent % doc->numPages()) * 100 / doc->numPages();
 			QString progress = QString("[%1] %2\% searched, %3 hits")
 				.arg(has_upper_case ? "Case" : "no case")
 				.arg(percent)
@@ -122,21 +144,27 @@ void SearchWorker::run() {
 			emit update_label_text(progress);
 
 			if (forward) {
-				if (++page == bar->doc->numPages()) {
+				if (++page == doc->numPages()) {
 					page = 0;
 				}
 			} else {
 				if (--page == -1) {
-					page = bar->doc->numPages() - 1;
+					page = doc->numPages() - 1;
 				}
 			}
 		} while (page != start);
+		Trace::get_instance()->end("search");
+		Stats::get_instance()->record_search(searched, timer.elapsed());
+		bar->pool->release(doc);
 #ifdef DEBUG
 		cerr << "done!" << endl;
 #endif
 		emit update_label_text(QString("[%1] done, %2 hits")
 				.arg(has_upper_case ? "Case" : "no case")
 				.arg(hit_count));
+		if (!stop && !die) {
+			emit search_finished();
+		}
 	}
 }
 
@@ -158,29 +186,21 @@ SearchBar::SearchBar(const QString &file, Viewer *v, QWidget *parent) :
 	layout->addWidget(progress);
 	setLayout(layout);
 
-	initialize(file, QByteArray());
+	initialize(file);
 }
 
-void SearchBar::initialize(const QString &file, const QByteArray &password) {
+void SearchBar::initialize(const QString &file) {
 	worker = NULL;
+	range_source = RangeSource::find(file);
 
-	doc = NULL;
-//	if (!file.isNull()) { // don't print the poppler error message for the second time
-	if (!file.isEmpty()) {
-		doc = Poppler::Document::load(file, QByteArray(), password);
-	}
-
-	if (doc == NULL) {
-		// poppler already prints a debug message
-		return;
-	}
-	if (doc->isLocked()) {
-		// poppler already prints a debug message
-//		cerr << "missing password" << endl;
-		delete doc;
-		doc = NULL;
+	pool = NULL;
+	// the resource manager already tried to open it
+	ResourceManager *res = viewer->get_res();
+	if (file.isEmpty() || !res->is_valid() || res->is_locked()) {
 		return;
 	}
+	pool = res->get_document_pool();
+	pool->ref();
 	worker = new SearchWorker(this);
 	worker->start();
 
@@ -192,6 +212,8 @@ void SearchBar::initialize(const QString &file, const QByteArray &password) {
 			this, SLOT(insert_hits(int, QList<QRectF> *)), Qt::UniqueConnection);
 	connect(worker, SIGNAL(clear_hits()),
 			this, SLOT(clear_hits()), Qt::UniqueConnection);
+	connect(worker, SIGNAL(search_finished()),
+			this, SIGNAL(search_finished()), Qt::UniqueConnection);
 }
 
 SearchBar::~SearchBar() {
@@ -205,20 +227,22 @@ void SearchBar::shutdown() {
 	if (worker != NULL) {
 		join_threads();
 	}
-	if (doc == NULL) {
-		return;
+	if (pool != NULL) {
+		pool->deref();
+		pool = NULL;
 	}
-	delete doc;
 	delete worker;
+	worker = NULL;
 }
 
-void SearchBar::load(const QString &file, const QByteArray &password) {
+void SearchBar::load(const QString &file) {
 	shutdown();
-	initialize(file, password);
+	initialize(file);
+	emit search_stopped();
 }
 
 bool SearchBar::is_valid() const {
-	return doc != NULL;
+	return worker != NULL;
 }
 
 void SearchBar::focus(bool forward) {
@@ -230,6 +254,12 @@ void SearchBar::focus(bool forward) {
 	show();
 }
 
+void SearchBar::search(const QString &term, bool forward) {
+	forward_tmp = forward;
+	line->setText(term);
+	set_text();
+}
+
 const std::map<int,QList<QRectF> *> *SearchBar::get_hits() const {
 	return &hits;
 }
@@ -307,6 +337,7 @@ void SearchBar::set_text() {
 
 	worker->stop = true;
 	search_mutex.unlock();
+	emit search_stopped();
 	c->setFocus(Qt::OtherFocusReason);
 }
 
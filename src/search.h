@@ -17,6 +17,8 @@
 class SearchBar;
 class Canvas;
 class Viewer;
+class RangeSource;
+class DocumentPool;
 
 
 class SearchWorker : public QThread {
@@ -32,6 +34,7 @@ public:
 signals:
 	void update_label_text(const QString &text);
 	void search_done(int page, QList<QRectF> *hits);
+	void search_finished();
 	void clear_hits();
 
 private:
@@ -47,14 +50,20 @@ public:
 	SearchBar(const QString &file, Viewer *v, QWidget *parent = 0);
 	~SearchBar();
 
-	void load(const QString &file, const QByteArray &password);
+	void load(const QString &file);
 	bool is_valid() const;
 	void focus(bool forward = true);
+	// starts a search without user interaction
+	void search(const QString &term, bool forward = true);
 	const std::map<int,QList<QRectF> *> *get_hits() const;
 	bool is_search_forward() const;
 
 signals:
 	void search_updated(int page);
+	// all pages have been searched
+	void search_finished();
+	// a running search, if any, won't finish: a new term or a reload
+	void search_stopped();
 
 protected:
 	// QT event handling
@@ -69,7 +78,7 @@ private slots:
 	void set_text();
 
 private:
-	void initialize(const QString &file, const QByteArray &password);
+	void initialize(const QString &file);
 	void join_threads();
 	void shutdown();
 
@@ -77,7 +86,8 @@ private:
 	QLabel *progress;
 	QHBoxLayout *layout;
 
-	Poppler::Document *doc;
+	DocumentPool *pool; // the worker takes a document while searching
+	RangeSource *range_source;
 	Viewer *viewer;
 
 	std::map<int,QList<QRectF> *> hits;
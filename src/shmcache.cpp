@@ -0,0 +1,268 @@
+#include "shmcache.h"
+#include <QFile>
+#include <QCryptographicHash>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#ifdef __linux__
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+
+#ifdef __linux__
+static const unsigned int shm_magic = 0x6b617431; // "kat1"
+static const int slot_count = 1024;
+
+
+class ShmCacheSlot {
+public:
+	int page; // -1 if empty
+	int width;
+	int rotation;
+	int img_width;
+	int img_height;
+	int format;
+	qint64 offset;
+	qint64 length;
+};
+
+// at the start of the segment, the image data follows
+class ShmCacheHeader {
+public:
+	volatile unsigned int magic; // set last by the creator
+	pthread_mutex_t mutex; // process shared, robust against crashed owners
+	int users;
+	qint64 data_size;
+	qint64 head; // next write position in the data ring
+	int next_slot;
+	ShmCacheSlot slots[slot_count];
+};
+#endif
+
+
+ShmCache::ShmCache(const QString &file, int size_mb) :
+		header(NULL),
+		data(NULL),
+		size(0) {
+#ifdef __linux__
+	struct stat st;
+	if (size_mb <= 0 || stat(QFile::encodeName(file).constData(), &st) == -1) {
+		return;
+	}
+	// same file and version, independent of the path it was opened with
+	QByteArray identity = QString("%1:%2:%3:%4.%5")
+		.arg(st.st_dev).arg(st.st_ino).arg(st.st_size)
+		.arg(st.st_mtim.tv_sec).arg(st.st_mtim.tv_nsec).toAscii();
+	name = "/katarakt-" + QCryptographicHash::hash(identity, QCryptographicHash::Sha1).toHex().left(16);
+
+	int fd = shm_open(name.constData(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	bool creator = fd != -1;
+	if (!creator) {
+		if (errno != EEXIST) {
+			cerr << "shm_open: " << strerror(errno) << endl;
+			return;
+		}
+		fd = shm_open(name.constData(), O_RDWR, 0600);
+		if (fd == -1) {
+			cerr << "shm_open: " << strerror(errno) << endl;
+			return;
+		}
+	}
+
+	if (creator) {
+		size = (size_t) size_mb * 1024 * 1024 + sizeof(ShmCacheHeader);
+		if (ftruncate(fd, size) == -1) {
+			cerr << "ftruncate: " << strerror(errno) << endl;
+			::close(fd);
+			shm_unlink(name.constData());
+			return;
+		}
+	} else {
+		// the creator may not have sized it yet, keep its size
+		for (int i = 0; i < 100; i++) {
+			if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(ShmCacheHeader)) {
+				size = st.st_size;
+				break;
+			}
+			usleep(1000);
+		}
+		if (size == 0) {
+			::close(fd);
+			return;
+		}
+	}
+
+	void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mem == MAP_FAILED) {
+		cerr << "mmap: " << strerror(errno) << endl;
+		if (creator) {
+			shm_unlink(name.constData());
+		}
+		return;
+	}
+	ShmCacheHeader *h = static_cast<ShmCacheHeader *>(mem);
+
+	if (creator) {
+		pthread_mutexattr_t attr;
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&h->mutex, &attr);
+		pthread_mutexattr_destroy(&attr);
+		h->users = 0;
+		h->data_size = size - sizeof(ShmCacheHeader);
+		h->head = 0;
+		h->next_slot = 0;
+		for (int i = 0; i < slot_count; i++) {
+			h->slots[i].page = -1;
+		}
+		__sync_synchronize();
+		h->magic = shm_magic;
+	} else {
+		for (int i = 0; i < 100 && h->magic != shm_magic; i++) {
+			usleep(1000);
+		}
+		if (h->magic != shm_magic) {
+			cerr << "shared page cache " << name.constData() << " is not initialized" << endl;
+			munmap(mem, size);
+			return;
+		}
+	}
+
+	header = h;
+	data = static_cast<char *>(mem) + sizeof(ShmCacheHeader);
+	lock();
+	header->users++;
+	unlock();
+#else
+	Q_UNUSED(file);
+	Q_UNUSED(size_mb);
+#endif
+}
+
+ShmCache::~ShmCache() {
+#ifdef __linux__
+	if (header == NULL) {
+		return;
+	}
+	lock();
+	// the last one removes the name, the memory goes away with the last mapping
+	if (--header->users == 0) {
+		shm_unlink(name.constData());
+	}
+	unlock();
+	munmap(header, size);
+#endif
+}
+
+bool ShmCache::is_valid() const {
+	return header != NULL;
+}
+
+bool ShmCache::get(int page, int width, int rotation, QImage &img) {
+#ifdef __linux__
+	if (header == NULL) {
+		return false;
+	}
+	lock();
+	for (int i = 0; i < slot_count; i++) {
+		const ShmCacheSlot &slot = header->slots[i];
+		if (slot.page != page || slot.width != width || slot.rotation != rotation) {
+			continue;
+		}
+		img = QImage(slot.img_width, slot.img_height, static_cast<QImage::Format>(slot.format));
+		if (img.isNull() || img.byteCount() != slot.length) {
+			img = QImage();
+			break;
+		}
+		memcpy(img.bits(), data + slot.offset, slot.length);
+		unlock();
+		return true;
+	}
+	unlock();
+#else
+	Q_UNUSED(page);
+	Q_UNUSED(width);
+	Q_UNUSED(rotation);
+	Q_UNUSED(img);
+#endif
+	return false;
+}
+
+void ShmCache::put(int page, int width, int rotation, const QImage &img) {
+#ifdef __linux__
+	if (header == NULL || img.isNull()) {
+		return;
+	}
+	qint64 length = img.byteCount();
+	lock();
+	if (length > header->data_size) {
+		unlock();
+		return;
+	}
+	for (int i = 0; i < slot_count; i++) {
+		const ShmCacheSlot &slot = header->slots[i];
+		if (slot.page == page && slot.width == width && slot.rotation == rotation) {
+			unlock(); // another instance was faster
+			return;
+		}
+	}
+
+	// ring buffer, drop the pages that get overwritten
+	if (header->head + length > header->data_size) {
+		header->head = 0;
+	}
+	qint64 offset = header->head;
+	for (int i = 0; i < slot_count; i++) {
+		ShmCacheSlot &slot = header->slots[i];
+		if (slot.page != -1 && slot.offset < offset + length && offset < slot.offset + slot.length) {
+			slot.page = -1;
+		}
+	}
+	memcpy(data + offset, img.constBits(), length);
+	header->head = offset + length;
+
+	ShmCacheSlot &slot = header->slots[header->next_slot];
+	header->next_slot = (header->next_slot + 1) % slot_count;
+	slot.page = page;
+	slot.width = width;
+	slot.rotation = rotation;
+	slot.img_width = img.width();
+	slot.img_height = img.height();
+	slot.format = img.format();
+	slot.offset = offset;
+	slot.length = length;
+	unlock();
+#else
+	Q_UNUSED(page);
+	Q_UNUSED(width);
+	Q_UNUSED(rotation);
+	Q_UNUSED(img);
+#endif
+}
+
+void ShmCache::lock() {
+#ifdef __linux__
+	if (pthread_mutex_lock(&header->mutex) == EOWNERDEAD) {
+		// an instance died while holding the lock, its write may be partial
+		for (int i = 0; i < slot_count; i++) {
+			header->slots[i].page = -1;
+		}
+		pthread_mutex_consistent(&header->mutex);
+	}
+#endif
+}
+
+void ShmCache::unlock() {
+#ifdef __linux__
+	pthread_mutex_unlock(&header->mutex);
+#endif
+}
+
@@ -0,0 +1,41 @@
+#ifndef SHMCACHE_H
+#define SHMCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QImage>
+#include <cstddef>
+
+
+class ShmCacheHeader;
+
+
+// rendered pages shared between katarakt instances showing the same file
+// lives in posix shared memory named after the file's identity, so a changed
+// file gets a new cache; pages are looked up by width and rotation
+class ShmCache {
+public:
+	ShmCache(const QString &file, int size_mb);
+	~ShmCache();
+
+	bool is_valid() const;
+
+	// copies the page into img, returns false if it is not cached
+	bool get(int page, int width, int rotation, QImage &img);
+	void put(int page, int width, int rotation, const QImage &img);
+
+private:
+	ShmCache(const ShmCache &other);
+	ShmCache &operator=(const ShmCache &other);
+
+	void lock();
+	void unlock();
+
+	QByteArray name;
+	ShmCacheHeader *header;
+	char *data;
+	size_t size;
+};
+
+#endif
+
@@ -0,0 +1,141 @@
+#include "stats.h"
+#include <QFile>
+#include <QTextStream>
+#include <iostream>
+
+using namespace std;
+
+
+//==[ Histogram ]==============================================================
+Histogram::Histogram() :
+		sum(0) {
+}
+
+void Histogram::add(int value) {
+	if (value < 0) {
+		value = 0;
+	}
+	// bucket i holds values below 2^i
+	int bucket = 0;
+	while (bucket < bucket_count - 1 && (value >> bucket) > 0) {
+		bucket++;
+	}
+	buckets[bucket].fetchAndAddRelaxed(1);
+	count.fetchAndAddRelaxed(1);
+	sum_mutex.lock();
+	sum += value;
+	sum_mutex.unlock();
+}
+
+int Histogram::get_count() const {
+	return count;
+}
+
+int Histogram::get_mean() const {
+	int c = count;
+	if (c == 0) {
+		return 0;
+	}
+	sum_mutex.lock();
+	qint64 s = sum;
+	sum_mutex.unlock();
+	return s / c;
+}
+
+int Histogram::get_percentile(float fraction) const {
+	int c = count;
+	int seen = 0;
+	for (int i = 0; i < bucket_count; i++) {
+		seen += buckets[i];
+		if (seen >= c * fraction) {
+			return 1 << i;
+		}
+	}
+	return 1 << (bucket_count - 1);
+}
+
+QString Histogram::to_string(const QString &unit) const {
+	return QString("n=%1 mean=%2%5 p50<%3%5 p95<%4%5")
+		.arg(get_count())
+		.arg(get_mean())
+		.arg(get_percentile(0.5f))
+		.arg(get_percentile(0.95f))
+		.arg(unit);
+}
+
+
+//==[ Stats ]==================================================================
+Stats::Stats() :
+		image_bytes(0),
+		search_pages(0),
+		search_time(0) {
+}
+
+Stats *Stats::get_instance() {
+	static Stats instance;
+	return &instance;
+}
+
+void Stats::record_render(int ms) {
+	render_time.add(ms);
+}
+
+void Stats::record_paint(int us) {
+	paint_time.add(us);
+}
+
+void Stats::record_queue(int length) {
+	queue_length.add(length);
+}
+
+void Stats::record_cache(bool hit) {
+	if (hit) {
+		cache_hits.fetchAndAddRelaxed(1);
+	} else {
+		cache_misses.fetchAndAddRelaxed(1);
+	}
+}
+
+void Stats::add_image_bytes(qint64 bytes) {
+	mutex.lock();
+	image_bytes += bytes;
+	mutex.unlock();
+}
+
+void Stats::record_search(int pages, int ms) {
+	mutex.lock();
+	search_pages += pages;
+	search_time += ms;
+	mutex.unlock();
+}
+
+QString Stats::report() const {
+	// the sum and hits * 100 overflow int long before the counters do
+	qint64 hits = cache_hits;
+	qint64 lookups = hits + cache_misses;
+	mutex.lock();
+	qint64 bytes = image_bytes;
+	qint64 pages = search_pages;
+	qint64 time = search_time;
+	mutex.unlock();
+	return QString("render: %1\npaint: %2\nqueue: %3\ncache hits: %4% of %5\nimages: %6 KiB\nsearch: %7 pages/s")
+		.arg(render_time.to_string("ms"))
+		.arg(paint_time.to_string("us"))
+		.arg(queue_length.to_string(""))
+		.arg(lookups > 0 ? hits * 100 / lookups : 0)
+		.arg(lookups)
+		.arg(bytes / 1024)
+		.arg(time > 0 ? pages * 1000 / time : 0);
+}
+
+bool Stats::write(const QString &file) const {
+	QFile f(file);
+	if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+		cerr << "failed to write stats to " << file.toUtf8().constData() << endl;
+		return false;
+	}
+	QTextStream out(&f);
+	out << report() << "\n";
+	return true;
+}
+
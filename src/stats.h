@@ -0,0 +1,67 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QString>
+
+
+// counts values in power of two buckets, safe to use from any thread
+class Histogram {
+public:
+	static const int bucket_count = 20;
+
+	Histogram();
+
+	void add(int value);
+
+	int get_count() const;
+	int get_mean() const;
+	// upper bound of the bucket containing the given fraction of values
+	int get_percentile(float fraction) const;
+	QString to_string(const QString &unit) const;
+
+private:
+	QAtomicInt buckets[bucket_count];
+	QAtomicInt count;
+	// 64 bit, microsecond paint times overflow an int quickly
+	// Qt 4 has no 64 bit atomics
+	mutable QMutex sum_mutex;
+	qint64 sum;
+};
+
+
+// always compiled instrumentation, cheap enough for every render and paint
+class Stats {
+private:
+	Stats();
+	Stats(const Stats &other);
+	Stats &operator=(const Stats &other);
+
+public:
+	static Stats *get_instance();
+
+	void record_render(int ms);
+	void record_paint(int us);
+	void record_queue(int length);
+	void record_cache(bool hit);
+	void add_image_bytes(qint64 bytes); // negative when freed
+	void record_search(int pages, int ms);
+
+	QString report() const;
+	bool write(const QString &file) const;
+
+private:
+	Histogram render_time;
+	Histogram paint_time;
+	Histogram queue_length;
+	QAtomicInt cache_hits;
+	QAtomicInt cache_misses;
+	mutable QMutex mutex; // for the 64 bit counters below
+	qint64 image_bytes;
+	qint64 search_pages;
+	qint64 search_time;
+};
+
+#endif
+
@@ -0,0 +1,466 @@
+#include "synctex.h"
+#include "config.h"
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <zlib.h>
+
+using namespace std;
+
+
+// sp per big point (1/72 in)
+#define SP_PER_BP 65781.76f
+
+
+static bool top_less(const SynctexBox &a, const SynctexBox &b) {
+	return a.rect.top() < b.rect.top();
+}
+
+static bool box_above(const SynctexBox &box, float y) {
+	return box.rect.top() < y;
+}
+
+static bool above_box(float y, const SynctexBox &box) {
+	return y < box.rect.top();
+}
+
+// reads "tag,line[,column]:x,y[:w[,h,d]]" after the record type
+// returns the number of values after the first colon
+static int read_record(const char *s, int &tag, int &line, int &column, long *v, int max) {
+	char *next;
+	tag = strtol(s, &next, 10);
+	if (*next != ',') {
+		return 0;
+	}
+	line = strtol(next + 1, &next, 10);
+	column = -1;
+	if (*next == ',') {
+		column = strtol(next + 1, &next, 10);
+	}
+	int count = 0;
+	while (count < max && (*next == ':' || *next == ',')) {
+		v[count++] = strtol(next + 1, &next, 10);
+	}
+	return count;
+}
+
+
+//==[ SynctexIndex ]===========================================================
+SynctexIndex::SynctexIndex() :
+		unit(1.0f),
+		magnification(1000.0f),
+		x_offset(0.0f),
+		y_offset(0.0f),
+		page(-1) {
+}
+
+bool SynctexIndex::parse(const QString &file) {
+	// also reads uncompressed files
+	gzFile f = gzopen(QFile::encodeName(file).constData(), "rb");
+	if (f == NULL) {
+		return false;
+	}
+	gzbuffer(f, 128 * 1024);
+	dir = QFileInfo(file).absolutePath();
+
+	char buf[4096];
+	while (gzgets(f, buf, sizeof(buf)) != NULL) {
+		size_t len = strlen(buf);
+		if (len > 0 && buf[len - 1] == '\n') {
+			buf[--len] = '\0';
+		}
+		// records are short, longer lines are paths or garbage
+		parse_line(buf, buf + len);
+	}
+	int error;
+	gzerror(f, &error);
+	gzclose(f);
+	if (error != Z_OK && error != Z_STREAM_END) {
+		cerr << "failed to read " << file.toUtf8().constData() << endl;
+		return false;
+	}
+
+	max_heights.resize(pages.size());
+	for (unsigned int i = 0; i < pages.size(); i++) {
+		stable_sort(pages[i].begin(), pages[i].end(), top_less);
+		max_heights[i] = 0.0f;
+		for (unsigned int j = 0; j < pages[i].size(); j++) {
+			max_heights[i] = max(max_heights[i], (float) pages[i][j].rect.height());
+		}
+	}
+	hboxes.clear();
+	return !pages.empty();
+}
+
+void SynctexIndex::parse_line(const char *s, const char *end) {
+	if (s == end) {
+		return;
+	}
+	int tag, line, column;
+	long v[5];
+
+	switch (*s) {
+		case '{': // page begins, 1 indexed
+			page = atoi(s + 1) - 1;
+			if (page < 0) {
+				page = -1;
+			} else if ((int) pages.size() <= page) {
+				pages.resize(page + 1);
+			}
+			return;
+		case '}':
+			page = -1;
+			hboxes.clear();
+			return;
+		case '[': // vbox, too coarse for lookups
+			hboxes.push_back(QRectF());
+			return;
+		case ']':
+		case ')':
+			if (!hboxes.empty()) {
+				hboxes.pop_back();
+			}
+			return;
+		case '(': // hbox
+		case 'h': // void hbox
+			if (page >= 0 && read_record(s + 1, tag, line, column, v, 5) == 5) {
+				SynctexBox box;
+				box.input = tag;
+				box.line = line;
+				box.column = column;
+				float x = v[0] * unit + x_offset;
+				float y = v[1] * unit + y_offset;
+				float w = v[2] * unit;
+				box.rect = QRectF(min(x, x + w), y - v[3] * unit,
+						w < 0 ? -w : w, (v[3] + v[4]) * unit).normalized();
+				box.position = false;
+				add_box(box);
+				if (*s == '(') {
+					hboxes.push_back(box.rect);
+				}
+			} else if (*s == '(') {
+				hboxes.push_back(QRectF());
+			}
+			return;
+		case 'x': // current position
+		case 'k': // kern
+		case 'g': // glue
+		case '$': // math
+			if (page >= 0 && read_record(s + 1, tag, line, column, v, 2) == 2) {
+				SynctexBox box;
+				box.input = tag;
+				box.line = line;
+				box.column = column;
+				float x = v[0] * unit + x_offset;
+				float y = v[1] * unit + y_offset;
+				box.rect = QRectF(x, y, 0, 0);
+				// takes the height of the surrounding hbox
+				for (int i = hboxes.size() - 1; i >= 0; i--) {
+					if (!hboxes[i].isNull()) {
+						box.rect = QRectF(x, hboxes[i].top(), 0, hboxes[i].height());
+						break;
+					}
+				}
+				box.position = true;
+				add_box(box);
+			}
+			return;
+		default:
+			break;
+	}
+
+	// preamble, inputs can also appear between pages
+	QByteArray l(s, end - s);
+	if (l.startsWith("Input:")) {
+		int colon = l.indexOf(':', 6);
+		if (colon != -1) {
+			QString path = QFile::decodeName(l.mid(colon + 1));
+			QFileInfo info(QDir(dir), path);
+			QString canonical = info.canonicalFilePath();
+			inputs[l.mid(6, colon - 6).toInt()] = canonical.isEmpty() ? info.absoluteFilePath() : canonical;
+		}
+	} else if (l.startsWith("Unit:")) {
+		unit = l.mid(5).toFloat();
+	} else if (l.startsWith("Magnification:")) {
+		magnification = l.mid(14).toFloat();
+	} else if (l.startsWith("X Offset:")) {
+		x_offset = l.mid(9).toFloat();
+	} else if (l.startsWith("Y Offset:")) {
+		y_offset = l.mid(9).toFloat();
+	} else if (l.startsWith("Content:")) {
+		// from now on everything is converted to points
+		if (magnification <= 0.0f) {
+			magnification = 1000.0f;
+		}
+		x_offset *= unit / SP_PER_BP;
+		y_offset *= unit / SP_PER_BP;
+		unit *= magnification / 1000.0f / SP_PER_BP;
+	}
+}
+
+void SynctexIndex::add_box(const SynctexBox &box) {
+	pages[page].push_back(box);
+	// the first output of each line, later ones don't replace it
+	lines.insert(make_pair(make_pair(box.input, box.line), make_pair(page, box.rect)));
+}
+
+int SynctexIndex::find_input(const QString &input) const {
+	QFileInfo info(input);
+	QString canonical = info.canonicalFilePath();
+	if (canonical.isEmpty()) {
+		canonical = info.absoluteFilePath();
+	}
+	for (map<int,QString>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+		if (it->second == canonical) {
+			return it->first;
+		}
+	}
+	// the editor may see the files under another path
+	for (map<int,QString>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+		if (QFileInfo(it->second).fileName() == info.fileName()) {
+			return it->first;
+		}
+	}
+	return -1;
+}
+
+bool SynctexIndex::find_source(int page, const QPointF &pos,
+		QString &input, int &line, int &column) const {
+	if (page < 0 || page >= (int) pages.size() || pages[page].empty()) {
+		return false;
+	}
+	const vector<SynctexBox> &boxes = pages[page];
+	float x = pos.x(), y = pos.y();
+
+	// only boxes starting at most the tallest box's height above y can contain it
+	vector<SynctexBox>::const_iterator first = lower_bound(boxes.begin(), boxes.end(),
+			(float) (y - max_heights[page]), box_above);
+	vector<SynctexBox>::const_iterator last = upper_bound(first, boxes.end(), y, above_box);
+
+	// innermost hbox
+	const SynctexBox *best = NULL;
+	for (vector<SynctexBox>::const_iterator it = first; it != last; ++it) {
+		if (!it->position && it->rect.bottom() >= y &&
+				it->rect.left() <= x && it->rect.right() >= x &&
+				(best == NULL || it->rect.width() < best->rect.width())) {
+			best = &*it;
+		}
+	}
+	if (best != NULL) {
+		// the last position left of x inside it has the exact line
+		const SynctexBox *exact = NULL;
+		for (vector<SynctexBox>::const_iterator it = first; it != last; ++it) {
+			if (it->position && it->rect.bottom() >= y &&
+					it->rect.left() >= best->rect.left() && it->rect.left() <= x &&
+					(exact == NULL || it->rect.left() > exact->rect.left())) {
+				exact = &*it;
+			}
+		}
+		if (exact != NULL) {
+			best = exact;
+		}
+	} else {
+		// nothing there, take the closest box on the page
+		float best_distance = 0.0f;
+		for (vector<SynctexBox>::const_iterator it = boxes.begin(); it != boxes.end(); ++it) {
+			float dx = max(max((float) it->rect.left() - x, x - (float) it->rect.right()), 0.0f);
+			float dy = max(max((float) it->rect.top() - y, y - (float) it->rect.bottom()), 0.0f);
+			float distance = dx * dx + dy * dy;
+			if (best == NULL || distance < best_distance) {
+				best = &*it;
+				best_distance = distance;
+			}
+		}
+	}
+
+	map<int,QString>::const_iterator it = inputs.find(best->input);
+	if (it == inputs.end()) {
+		return false;
+	}
+	input = it->second;
+	line = best->line;
+	column = best->column;
+	return true;
+}
+
+bool SynctexIndex::find_output(const QString &input, int line, int &page, QRectF &rect) const {
+	int tag = find_input(input);
+	if (tag == -1) {
+		return false;
+	}
+	map<pair<int,int>,pair<int,QRectF> >::const_iterator it = lines.lower_bound(make_pair(tag, line));
+	if (it == lines.end() || it->first.first != tag) {
+		return false;
+	}
+	page = it->second.first;
+	rect = it->second.second;
+	return true;
+}
+
+
+//==[ SynctexLoader ]==========================================================
+SynctexLoader::SynctexLoader(const QString &file) :
+		file(file),
+		index(NULL) {
+}
+
+SynctexLoader::~SynctexLoader() {
+	wait();
+	delete index;
+}
+
+void SynctexLoader::load() {
+	index = new SynctexIndex();
+	if (!index->parse(file)) {
+		delete index;
+		index = NULL;
+	}
+}
+
+SynctexIndex *SynctexLoader::take_index() {
+	SynctexIndex *i = index;
+	index = NULL;
+	return i;
+}
+
+
+//==[ Synctex ]================================================================
+Synctex::Synctex(QObject *parent) :
+		QObject(parent),
+		size(-1),
+		loader(NULL),
+		reload_pending(false),
+		index(NULL) {
+	reload_timer.setSingleShot(true);
+	reload_timer.setInterval(CFG::get_instance()->get_value("Settings/reload_delay").toInt());
+	connect(&reload_timer, SIGNAL(timeout()), this, SLOT(reload()));
+}
+
+Synctex::~Synctex() {
+	shutdown();
+}
+
+void Synctex::shutdown() {
+	reload_timer.stop();
+	if (loader != NULL) {
+		// can't be interrupted, let it finish on its own
+		disconnect(loader, SIGNAL(finished()), this, SLOT(loaded()));
+		loader->detach();
+		loader = NULL;
+	}
+	reload_pending = false;
+	delete index;
+	index = NULL;
+	file = QString();
+	size = -1;
+}
+
+void Synctex::load(const QString &pdf) {
+	if (pdf == this->pdf) {
+		return;
+	}
+	shutdown();
+	this->pdf = pdf;
+
+	candidates.clear();
+	if (pdf.isEmpty()) {
+		return;
+	}
+	QString base = pdf;
+	if (base.endsWith(".pdf", Qt::CaseInsensitive)) {
+		base.chop(4);
+	}
+	candidates << base + ".synctex.gz" << base + ".synctex";
+	reload();
+}
+
+bool Synctex::is_ready() const {
+	return index != NULL;
+}
+
+bool Synctex::find_source(int page, const QPointF &pos,
+		QString &input, int &line, int &column) const {
+	if (index == NULL) {
+		return false;
+	}
+	return index->find_source(page, pos, input, line, column);
+}
+
+bool Synctex::find_output(const QString &input, int line, int &page, QRectF &rect) const {
+	if (index == NULL) {
+		return false;
+	}
+	return index->find_output(input, line, page, rect);
+}
+
+void Synctex::file_changed(const QString &name) {
+	Q_FOREACH(const QString &candidate, candidates) {
+		if (QFileInfo(candidate).fileName() == name) {
+			// coalesce the writes like for the document
+			reload_timer.start();
+			return;
+		}
+	}
+}
+
+void Synctex::reload() {
+	if (loader != NULL) {
+		reload_pending = true;
+		return;
+	}
+
+	QFileInfo info;
+	Q_FOREACH(const QString &candidate, candidates) {
+		info = QFileInfo(candidate);
+		if (info.exists()) {
+			break;
+		}
+	}
+	if (!info.exists()) {
+		delete index;
+		index = NULL;
+		file = QString();
+		return;
+	}
+	// nothing to do if the file wasn't written again
+	if (index != NULL && info.filePath() == file &&
+			info.lastModified() == modified && info.size() == size) {
+		return;
+	}
+	file = info.filePath();
+	modified = info.lastModified();
+	size = info.size();
+
+	loader = new SynctexLoader(file);
+	connect(loader, SIGNAL(finished()), this, SLOT(loaded()), Qt::UniqueConnection);
+	loader->start(QThread::LowPriority);
+}
+
+void Synctex::loaded() {
+	// queued before the loader was detached
+	if (sender() != loader) {
+		return;
+	}
+	SynctexIndex *new_index = loader->take_index();
+	delete loader;
+	loader = NULL;
+
+	// a broken file keeps the old index
+	if (new_index != NULL) {
+		delete index;
+		index = new_index;
+	} else {
+		cerr << "failed to parse " << file.toUtf8().constData() << endl;
+		size = -1; // try again on the next change
+	}
+
+	if (reload_pending) {
+		reload_pending = false;
+		reload();
+	}
+}
+
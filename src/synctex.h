@@ -0,0 +1,123 @@
+#ifndef SYNCTEX_H
+#define SYNCTEX_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QRectF>
+#include <QDateTime>
+#include <QTimer>
+#include <map>
+#include <vector>
+#include "loaderthread.h"
+
+
+// part of the typeset output and the source line it came from
+class SynctexBox {
+public:
+	int input; // tag of the input file
+	int line;
+	int column; // -1 if unknown
+	QRectF rect; // points from the page's top left corner, zero width for positions
+	bool position; // glue, kern, math or current position inside an hbox
+};
+
+
+// everything from a .synctex(.gz) file, read only after parsing
+// page -> boxes for inverse search, source line -> rects for forward search
+class SynctexIndex {
+public:
+	SynctexIndex();
+
+	// file is the .synctex.gz or .synctex
+	bool parse(const QString &file);
+
+	// innermost box at pos (points, page 0 indexed), or the nearest one
+	bool find_source(int page, const QPointF &pos,
+			QString &input, int &line, int &column) const;
+	// first output of line, or of the next line that produced any
+	bool find_output(const QString &input, int line, int &page, QRectF &rect) const;
+
+private:
+	void parse_line(const char *s, const char *end);
+	void add_box(const SynctexBox &box);
+	int find_input(const QString &input) const;
+
+	QString dir; // inputs are relative to this
+	std::map<int,QString> inputs; // tag -> canonical path
+	float unit; // points per synctex unit
+	float magnification;
+	float x_offset;
+	float y_offset;
+
+	int page; // while parsing, -1 outside pages
+	std::vector<QRectF> hboxes; // open boxes while parsing, null rect for vboxes
+
+	std::vector<std::vector<SynctexBox> > pages; // sorted by top
+	std::vector<float> max_heights; // per page, bounds the scan in find_source
+	std::map<std::pair<int,int>,std::pair<int,QRectF> > lines; // (input, line) -> page, rect
+};
+
+
+// parses without blocking the gui
+class SynctexLoader : public LoaderThread {
+	Q_OBJECT
+
+public:
+	SynctexLoader(const QString &file);
+	~SynctexLoader();
+
+	// NULL if parsing failed, only valid after the thread finished
+	SynctexIndex *take_index();
+
+protected:
+	void load();
+
+private:
+	QString file;
+	SynctexIndex *index;
+};
+
+
+// keeps the index of the synctex file next to the document up to date
+class Synctex : public QObject {
+	Q_OBJECT
+
+public:
+	Synctex(QObject *parent = 0);
+	~Synctex();
+
+	// looks for name.synctex.gz or name.synctex next to the pdf
+	void load(const QString &pdf);
+	bool is_ready() const;
+
+	// see SynctexIndex, false until the index is parsed
+	bool find_source(int page, const QPointF &pos,
+			QString &input, int &line, int &column) const;
+	bool find_output(const QString &input, int line, int &page, QRectF &rect) const;
+
+public slots:
+	// name of a changed file in the document's directory
+	void file_changed(const QString &name);
+
+private slots:
+	void reload();
+	void loaded();
+
+private:
+	void shutdown();
+
+	QString pdf;
+	QStringList candidates; // possible synctex files, preferred first
+	QString file; // the one the index was read from
+	QDateTime modified; // of file, unchanged files aren't parsed again
+	qint64 size;
+
+	SynctexLoader *loader;
+	bool reload_pending; // changed again while parsing
+	SynctexIndex *index;
+	QTimer reload_timer;
+};
+
+#endif
+
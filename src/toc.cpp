@@ -3,19 +3,130 @@
 #include <QDomDocument>
 #include <QDomNode>
 #include <QHeaderView>
+#include <algorithm>
 #include "toc.h"
 #include "viewer.h"
 #include "canvas.h"
 #include "layout/layout.h"
 #include "resourcemanager.h"
+#include "documentpool.h"
 #include "util.h"
 
+using namespace std;
 
-Q_DECLARE_METATYPE(Poppler::LinkDestination *)
+Q_DECLARE_METATYPE(TocEntry *)
 
 
+//==[ TocEntry ]===============================================================
+TocEntry::TocEntry(TocEntry *parent) :
+		page(-1),
+		parent(parent),
+		index(0) {
+}
+
+TocEntry::~TocEntry() {
+	for (unsigned int i = 0; i < children.size(); i++) {
+		delete children[i];
+	}
+}
+
+
+static bool page_less(const pair<int,TocEntry *> &a, const pair<int,TocEntry *> &b) {
+	return a.first < b.first;
+}
+
+
+//==[ TocLoader ]==============================================================
+TocLoader::TocLoader(DocumentPool *pool) :
+		pool(pool),
+		doc(NULL),
+		root(NULL) {
+	pool->ref();
+}
+
+TocLoader::~TocLoader() {
+	wait();
+	delete root;
+	pool->deref();
+}
+
+void TocLoader::load() {
+	doc = pool->acquire();
+	QDomDocument *contents = NULL;
+	if (doc != NULL && !doc->isLocked()) {
+		contents = doc->toc();
+	}
+	if (contents != NULL) {
+		root = new TocEntry(NULL);
+		build(*contents, root);
+		delete contents;
+	}
+	pool->release(doc);
+	doc = NULL;
+
+	// stable, so the deepest entry comes last for pages shared with its parents
+	stable_sort(page_index.begin(), page_index.end(), page_less);
+}
+
+void TocLoader::take_index(vector<pair<int,TocEntry *> > &index) {
+	index.swap(page_index);
+	page_index.clear();
+}
+
+TocEntry *TocLoader::take_root() {
+	TocEntry *r = root;
+	root = NULL;
+	return r;
+}
+
+void TocLoader::build(const QDomNode &node, TocEntry *parent) {
+	QDomNodeList list = node.childNodes();
+	parent->children.reserve(list.count());
+	for (int i = 0; i < list.count(); i++) {
+		QDomNode n = list.at(i);
+
+		TocEntry *entry = new TocEntry(parent);
+		entry->title = n.nodeName();
+		QDomNamedNodeMap attributes = n.attributes();
+		QDomNode dest = attributes.namedItem("Destination");
+		if (!dest.isNull()) {
+			entry->destination = dest.nodeValue();
+			entry->page = Poppler::LinkDestination(entry->destination).pageNumber();
+		} else {
+			dest = attributes.namedItem("DestinationName");
+			if (!dest.isNull()) {
+				entry->destination_name = dest.nodeValue();
+				Poppler::LinkDestination *link = doc->linkDestination(entry->destination_name);
+				if (link != NULL) {
+					entry->page = link->pageNumber();
+					delete link;
+				}
+			}
+		}
+		// TODO check "ExternalFileName"
+		// TODO take "Open" into account?
+		entry->index = parent->children.size();
+		parent->children.push_back(entry);
+		if (entry->page > 0) {
+			page_index.push_back(make_pair(entry->page - 1, entry));
+		}
+
+		if (n.hasChildNodes()) {
+			build(n, entry);
+		}
+	}
+}
+
+
+//==[ Toc ]====================================================================
 Toc::Toc(Viewer *v, QWidget *parent) :
-		QTreeWidget(parent), viewer(v) {
+		QTreeWidget(parent),
+		viewer(v),
+		loader(NULL),
+		root(NULL),
+		current_page(-1),
+		current_entry(NULL),
+		current_shown(true) {
 	setColumnCount(2);
 
 	QHeaderView *h = header();
@@ -29,6 +140,7 @@ Toc::Toc(Viewer *v, QWidget *parent) :
 	setAlternatingRowColors(true);
 
 	connect(this, SIGNAL(itemActivated(QTreeWidgetItem *, int)), this, SLOT(goto_link(QTreeWidgetItem *, int)), Qt::UniqueConnection);
+	connect(this, SIGNAL(itemExpanded(QTreeWidgetItem *)), this, SLOT(expand(QTreeWidgetItem *)), Qt::UniqueConnection);
 
 	init();
 }
@@ -36,17 +148,16 @@ Toc::Toc(Viewer *v, QWidget *parent) :
 void Toc::init() {
 	shutdown();
 
-	QDomDocument *contents = viewer->get_res()->get_toc();
-	if (contents != NULL) {
-		build(contents, invisibleRootItem());
-		delete contents;
+	ResourceManager *res = viewer->get_res();
+	if (!res->is_valid() || res->is_locked()) {
+		set_status("(empty)");
+		return;
 	}
 
-	// indicate empty toc
-	if (topLevelItemCount() == 0) {
-		QTreeWidgetItem *item = new QTreeWidgetItem(invisibleRootItem(), QStringList("(empty)"));
-		item->setFlags(Qt::NoItemFlags);
-	}
+	set_status("(loading)");
+	loader = new TocLoader(res->get_document_pool());
+	connect(loader, SIGNAL(finished()), this, SLOT(loaded()), Qt::UniqueConnection);
+	loader->start(QThread::LowPriority);
 }
 
 Toc::~Toc() {
@@ -54,27 +165,162 @@ Toc::~Toc() {
 }
 
 void Toc::shutdown() {
-	QTreeWidgetItemIterator it(this);
-	while (*it) {
-		delete (*it)->data(0, Qt::UserRole).value<Poppler::LinkDestination *>();
-		++it;
+	if (loader != NULL) {
+		// poppler can't be interrupted, let it finish on its own
+		disconnect(loader, SIGNAL(finished()), this, SLOT(loaded()));
+		loader->detach();
+		loader = NULL;
 	}
 
 	clear();
+	delete root;
+	root = NULL;
+	page_index.clear();
+	current_entry = NULL;
+	current_shown = true;
+}
+
+void Toc::loaded() {
+	// queued before the loader was detached
+	if (sender() != loader) {
+		return;
+	}
+	root = loader->take_root();
+	loader->take_index(page_index);
+	delete loader;
+	loader = NULL;
+
+	clear();
+	if (root != NULL) {
+		populate(root, invisibleRootItem());
+	}
+	// indicate empty toc
+	if (topLevelItemCount() == 0) {
+		set_status("(empty)");
+	}
+
+	if (current_page != -1) {
+		int page = current_page;
+		current_page = -1;
+		set_current_page(page);
+	}
+}
+
+void Toc::set_current_page(int page) {
+	// called on every page change, only searches unless the entry changes
+	if (page == current_page) {
+		return;
+	}
+	current_page = page;
+
+	vector<pair<int,TocEntry *> >::iterator it = upper_bound(page_index.begin(), page_index.end(),
+			make_pair(page, (TocEntry *) NULL), page_less);
+	TocEntry *entry = NULL;
+	if (it != page_index.begin()) {
+		entry = (--it)->second;
+	}
+	if (entry == current_entry) {
+		return;
+	}
+	current_entry = entry;
+	current_shown = false;
+
+	// creating and expanding items waits until the toc is visible
+	if (isVisible()) {
+		show_entry(entry);
+	}
+}
+
+void Toc::showEvent(QShowEvent *e) {
+	if (!current_shown) {
+		show_entry(current_entry);
+	}
+	QTreeWidget::showEvent(e);
+}
+
+void Toc::show_entry(TocEntry *entry) {
+	current_shown = true;
+	if (entry == NULL) {
+		setCurrentItem(NULL);
+		return;
+	}
+
+	// path from the top, expanding creates the children
+	vector<TocEntry *> path;
+	for (TocEntry *e = entry; e->parent != NULL; e = e->parent) {
+		path.push_back(e);
+	}
+	QTreeWidgetItem *item = invisibleRootItem();
+	for (int i = path.size() - 1; i >= 0; i--) {
+		if (item != invisibleRootItem()) {
+			item->setExpanded(true); // populates through expand()
+		}
+		item = item->child(path[i]->index);
+		if (item == NULL) {
+			return;
+		}
+	}
+	setCurrentItem(item);
+	scrollToItem(item);
+}
+
+void Toc::expand(QTreeWidgetItem *item) {
+	TocEntry *entry = item->data(0, Qt::UserRole).value<TocEntry *>();
+	if (entry != NULL && item->childCount() == 0) {
+		populate(entry, item);
+	}
+}
+
+void Toc::populate(TocEntry *entry, QTreeWidgetItem *parent) {
+	QList<QTreeWidgetItem *> items;
+	for (unsigned int i = 0; i < entry->children.size(); i++) {
+		TocEntry *child = entry->children[i];
+
+		QStringList strings;
+		strings << child->title;
+		if (child->page != -1) {
+			strings << QString::number(child->page);
+		}
+		QTreeWidgetItem *item = new QTreeWidgetItem(strings);
+		item->setTextAlignment(1, Qt::AlignRight);
+		item->setData(0, Qt::UserRole, QVariant::fromValue(child));
+		// children are created when expanded
+		if (!child->children.empty()) {
+			item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+		}
+		items.push_back(item);
+	}
+	parent->addChildren(items);
+}
+
+void Toc::set_status(const QString &text) {
+	clear();
+	QTreeWidgetItem *item = new QTreeWidgetItem(invisibleRootItem(), QStringList(text));
+	item->setFlags(Qt::NoItemFlags);
 }
 
 void Toc::goto_link(QTreeWidgetItem *item, int column) {
 	if (column == -1) {
 		return;
 	}
-	// handle empty-indicator
-	if (item->text(1).isEmpty()) {
+	// handle status indicator
+	TocEntry *entry = item->data(0, Qt::UserRole).value<TocEntry *>();
+	if (entry == NULL) {
 		return;
 	}
 
-	Poppler::LinkDestination *link = item->data(0, Qt::UserRole).value<Poppler::LinkDestination *>();
+	Poppler::LinkDestination *link = NULL;
+	if (!entry->destination.isEmpty()) {
+		link = new Poppler::LinkDestination(entry->destination);
+	} else if (!entry->destination_name.isEmpty()) {
+		link = viewer->get_res()->resolve_link_destination(entry->destination_name);
+	}
+	if (link == NULL) {
+		return;
+	}
 	viewer->get_canvas()->get_layout()->goto_link_destination(*link);
 	viewer->get_canvas()->setFocus(Qt::OtherFocusReason);
+	delete link;
 }
 
 bool Toc::event(QEvent *e) {
@@ -105,43 +351,3 @@ bool Toc::event(QEvent *e) {
 	return QTreeWidget::event(e);
 }
 
-void Toc::build(QDomNode *node, QTreeWidgetItem *parent) {
-	if (node->isNull() || !node->hasChildNodes()) {
-		return;
-	}
-
-	QDomNodeList list = node->childNodes();
-	for (int i = 0; i < list.count(); i++) {
-		QDomNode n = list.at(i);
-
-		QStringList strings;
-		strings << n.nodeName();
-		QDomNamedNodeMap attributes = n.attributes();
-		QDomNode dest = attributes.namedItem("Destination");
-		Poppler::LinkDestination *link = NULL;
-		if (!dest.isNull()) {
-//			strings << dest.nodeValue();
-			link = new Poppler::LinkDestination(dest.nodeValue());
-		} else {
-			dest = attributes.namedItem("DestinationName");
-			if (!dest.isNull()) {
-				link = viewer->get_res()->resolve_link_destination(dest.nodeValue());
-//				if (dest_page >= 0) {
-//					strings << QString::number(dest_page);
-//				}
-			}
-		}
-		if (!dest.isNull() && link != NULL) {
-			strings << QString::number(link->pageNumber());
-		}
-		// TODO check "ExternalFileName"
-		// TODO take "Open" into account?
-
-		QTreeWidgetItem *item = new QTreeWidgetItem(parent, strings);
-		item->setTextAlignment(1, Qt::AlignRight);
-		item->setData(0, Qt::UserRole, QVariant::fromValue(link));
-
-		build(&n, item);
-	}
-}
-
@@ -2,13 +2,59 @@
 #define TOC_H
 
 #include <QTreeWidget>
+#include <poppler/qt4/poppler-qt4.h>
+#include <vector>
+#include "loaderthread.h"
 
 
-class QDomDocument;
 class QDomNode;
+class DocumentPool;
 class Viewer;
 
 
+// one outline entry, independent of the widget
+class TocEntry {
+public:
+	TocEntry(TocEntry *parent);
+	~TocEntry();
+
+	QString title;
+	QString destination; // serialized Poppler::LinkDestination
+	QString destination_name; // named destination, resolved on demand
+	int page; // 1 indexed, -1 if not resolved yet
+
+	TocEntry *parent;
+	int index; // in parent's children
+	std::vector<TocEntry *> children;
+};
+
+
+// reads the outline with a document of its own, big outlines take a while
+class TocLoader : public LoaderThread {
+	Q_OBJECT
+
+public:
+	TocLoader(DocumentPool *pool);
+	~TocLoader();
+
+	// hands over the entries after the thread finished
+	TocEntry *take_root();
+	// entries sorted by page, in outline order for the same page
+	void take_index(std::vector<std::pair<int,TocEntry *> > &index);
+
+protected:
+	void load();
+
+private:
+	void build(const QDomNode &node, TocEntry *parent);
+
+	DocumentPool *pool;
+	Poppler::Document *doc;
+	TocEntry *root;
+	std::vector<std::pair<int,TocEntry *> > page_index;
+};
+
+
 class Toc : public QTreeWidget {
 	Q_OBJECT
 
@@ -17,18 +63,34 @@ public:
 	~Toc();
 
 	void init();
+	// shows the last entry starting on or before page, 0 indexed
+	void set_current_page(int page);
 
 public slots:
 	void goto_link(QTreeWidgetItem *item, int column);
 
 protected:
 	bool event(QEvent *e);
+	void showEvent(QShowEvent *e);
+
+private slots:
+	void loaded();
+	void expand(QTreeWidgetItem *item);
 
 private:
 	void shutdown();
-	void build(QDomNode *node, QTreeWidgetItem *parent);
+	// creates the items for the entry's children
+	void populate(TocEntry *entry, QTreeWidgetItem *parent);
+	void set_status(const QString &text);
+	void show_entry(TocEntry *entry);
 
 	Viewer *viewer;
+	TocLoader *loader;
+	TocEntry *root;
+	std::vector<std::pair<int,TocEntry *> > page_index;
+	int current_page;
+	TocEntry *current_entry;
+	bool current_shown;
 };
 
 #endif
@@ -0,0 +1,217 @@
+#include "trace.h"
+#include <QThread>
+#include <QThreadStorage>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+
+// the calling thread's buffer, registered on its first event
+static __thread TraceBuffer *thread_buffer = NULL;
+
+
+// threads are recreated on every reload, their ring buffers must not pile up
+// QThreadStorage deletes this when the thread exits
+class TraceThreadExit {
+public:
+	TraceThreadExit(TraceBuffer *buffer) :
+			buffer(buffer) {
+	}
+
+	~TraceThreadExit() {
+		thread_buffer = NULL;
+		Trace::get_instance()->thread_finished(buffer);
+	}
+
+private:
+	TraceBuffer *buffer;
+};
+
+static QThreadStorage<TraceThreadExit *> thread_exit;
+
+
+//==[ TraceBuffer ]============================================================
+TraceBuffer::TraceBuffer(int size, int id, const QString &name) :
+		events(size),
+		written(0),
+		id(id),
+		name(name),
+		finished(false) {
+}
+
+
+//==[ Trace ]==================================================================
+Trace::Trace() :
+		enabled(false),
+		buffer_size(0),
+		next_id(0),
+		finished_events(0) {
+}
+
+Trace *Trace::get_instance() {
+	static Trace instance;
+	return &instance;
+}
+
+void Trace::start(int buffer_size) {
+	if (enabled || buffer_size <= 0) {
+		return;
+	}
+	this->buffer_size = buffer_size;
+	clock.start();
+	enabled = true;
+}
+
+bool Trace::is_enabled() const {
+	return enabled;
+}
+
+void Trace::begin(const char *name, int page) {
+	if (enabled) {
+		record(name, 'B', page);
+	}
+}
+
+void Trace::end(const char *name, int page) {
+	if (enabled) {
+		record(name, 'E', page);
+	}
+}
+
+void Trace::record(const char *name, char phase, int page) {
+	TraceBuffer *buffer = get_buffer();
+	TraceEvent &event = buffer->events[buffer->written % buffer_size];
+	event.name = name;
+	event.phase = phase;
+	event.page = page;
+	event.time = clock.nsecsElapsed() / 1000;
+	buffer->written.fetchAndAddRelease(1);
+}
+
+TraceBuffer *Trace::get_buffer() {
+	if (thread_buffer != NULL) {
+		return thread_buffer;
+	}
+	QThread *thread = QThread::currentThread();
+	QString name;
+	if (thread == QCoreApplication::instance()->thread()) {
+		name = "gui";
+	} else {
+		name = thread->metaObject()->className();
+	}
+
+	mutex.lock();
+	thread_buffer = new TraceBuffer(buffer_size, next_id++, name);
+	buffers.push_back(thread_buffer);
+	mutex.unlock();
+	thread_exit.setLocalData(new TraceThreadExit(thread_buffer));
+	return thread_buffer;
+}
+
+void Trace::thread_finished(TraceBuffer *buffer) {
+	// copy the recorded events in order and free the ring
+	int written = buffer->written;
+	int oldest = written > buffer_size ? written - buffer_size : 0;
+	QVector<TraceEvent> events;
+	events.reserve(written - oldest);
+	for (int i = oldest; i < written; i++) {
+		events.push_back(buffer->events[i % buffer_size]);
+	}
+
+	mutex.lock();
+	buffer->events = events;
+	buffer->written = events.size();
+	buffer->finished = true;
+	finished_events += events.size();
+	// drop the oldest exited threads
+	for (unsigned int i = 0; i < buffers.size() && finished_events > buffer_size; ) {
+		if (buffers[i]->finished) {
+			finished_events -= buffers[i]->written;
+			delete buffers[i];
+			buffers.erase(buffers.begin() + i);
+		} else {
+			i++;
+		}
+	}
+	mutex.unlock();
+}
+
+bool Trace::write(const QString &file) {
+	if (!enabled) {
+		return false;
+	}
+	QFile f(file);
+	if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+		cerr << "failed to write trace to " << file.toUtf8().constData() << endl;
+		return false;
+	}
+	QTextStream out(&f);
+	qint64 pid = QCoreApplication::applicationPid();
+
+	out << "{\"traceEvents\":[\n";
+	bool first = true;
+	mutex.lock();
+	for (unsigned int i = 0; i < buffers.size(); i++) {
+		TraceBuffer *buffer = buffers[i];
+		if (!first) {
+			out << ",\n";
+		}
+		first = false;
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+			<< ",\"tid\":" << buffer->id
+			<< ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+
+		// the owning thread keeps writing, copy the events it has published
+		// events older than one buffer length are overwritten
+		int written = buffer->written.fetchAndAddAcquire(0);
+		int oldest = written > buffer_size ? written - buffer_size : 0;
+		QVector<TraceEvent> events;
+		events.reserve(written - oldest);
+		for (int j = oldest; j < written; j++) {
+			events.push_back(buffer->events[j % buffer_size]);
+		}
+		// drop the copies whose slots were reused while copying, including the
+		// one being written right now; the ordered read stays after the copies
+		int skip = 0;
+		if (!buffer->finished) {
+			int now = buffer->written.fetchAndAddOrdered(0);
+			skip = max(now - buffer_size + 1 - oldest, 0);
+		}
+		int depth = 0;
+		for (int j = skip; j < events.size(); j++) {
+			const TraceEvent &event = events[j];
+			// the begin of this was overwritten
+			if (event.phase == 'E' && depth == 0) {
+				continue;
+			}
+			depth += event.phase == 'B' ? 1 : -1;
+			out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase
+				<< "\",\"ts\":" << event.time
+				<< ",\"pid\":" << pid << ",\"tid\":" << buffer->id;
+			if (event.page >= 0) {
+				out << ",\"args\":{\"page\":" << event.page << "}";
+			}
+			out << "}";
+		}
+	}
+	mutex.unlock();
+	out << "\n]}\n";
+	return true;
+}
+
+
+//==[ TraceScope ]=============================================================
+TraceScope::TraceScope(const char *name, int page) :
+		name(name),
+		page(page) {
+	Trace::get_instance()->begin(name, page);
+}
+
+TraceScope::~TraceScope() {
+	Trace::get_instance()->end(name, page);
+}
+
@@ -0,0 +1,87 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <vector>
+
+
+class TraceEvent {
+public:
+	const char *name; // string literal, never copied
+	char phase; // 'B'egin or 'E'nd
+	int page; // -1 if not page related
+	qint64 time; // microseconds since tracing started
+};
+
+
+// written by exactly one thread, read when dumping
+class TraceBuffer {
+public:
+	TraceBuffer(int size, int id, const QString &name);
+
+	QVector<TraceEvent> events;
+	// total number of events, wraps around events
+	// raised with release semantics after an event is complete
+	QAtomicInt written;
+	int id;
+	QString name;
+	bool finished; // thread exited, events shrunk to the recorded ones
+};
+
+
+// records begin/end events into per-thread ring buffers, disabled by default
+// dumps them in the Chrome trace event format (chrome://tracing, Perfetto)
+class Trace {
+private:
+	Trace();
+	Trace(const Trace &other);
+	Trace &operator=(const Trace &other);
+
+public:
+	static Trace *get_instance();
+
+	// buffer_size is the number of events kept per thread
+	void start(int buffer_size);
+	bool is_enabled() const;
+
+	void begin(const char *name, int page = -1);
+	void end(const char *name, int page = -1);
+
+	bool write(const QString &file);
+
+private:
+	friend class TraceThreadExit;
+
+	void record(const char *name, char phase, int page);
+	TraceBuffer *get_buffer();
+	// keeps the events of an exited thread, bounded by buffer_size in total
+	void thread_finished(TraceBuffer *buffer);
+
+	volatile bool enabled;
+	int buffer_size;
+	QElapsedTimer clock;
+
+	QMutex mutex; // guards buffers, not the events of running threads
+	std::vector<TraceBuffer *> buffers; // oldest first
+	int next_id;
+	int finished_events; // in finished buffers
+};
+
+
+// begin event on construction, end event when leaving the scope
+class TraceScope {
+public:
+	TraceScope(const char *name, int page = -1);
+	~TraceScope();
+
+private:
+	const char *name;
+	int page;
+};
+
+#endif
+
@@ -1,8 +1,11 @@
 #include <QAction>
 #include <QObject>
+#include <vector>
 #include "util.h"
 #include "config.h"
 
+using namespace std;
+
 
 const QRectF rotate_rect(const QRectF &rect, float w, float h, int rotation) {
 	if (rotation == 0) {
@@ -43,6 +46,69 @@ QRect transform_rect_expand(const QRectF &rect, float scale, int off_x, int off_
 			rect.height() * scale + 2 * rect_margin);
 }
 
+QImage downscale_image(const QImage &source, int width) {
+	QImage src = source;
+	if (src.format() != QImage::Format_RGB32 &&
+			src.format() != QImage::Format_ARGB32 &&
+			src.format() != QImage::Format_ARGB32_Premultiplied) {
+		src = src.convertToFormat(QImage::Format_ARGB32);
+	}
+	int src_w = src.width();
+	int src_h = src.height();
+	if (width >= src_w || width <= 0) {
+		return src;
+	}
+	int height = ROUND(src_h * width / (float) src_w);
+	if (height < 1) {
+		height = 1;
+	}
+
+	// average all source pixels falling into a destination pixel
+	// channels are summed bytewise, plain loops the compiler can vectorize
+	QImage dst(width, height, src.format());
+	vector<unsigned int> row_sum(src_w * 4);
+	for (int y = 0; y < height; y++) {
+		int y0 = y * src_h / height;
+		int y1 = (y + 1) * src_h / height;
+		if (y1 <= y0) {
+			y1 = y0 + 1;
+		}
+
+		unsigned int *sum = &row_sum[0];
+		for (int i = 0; i < src_w * 4; i++) {
+			sum[i] = 0;
+		}
+		for (int sy = y0; sy < y1; sy++) {
+			const uchar *line = src.constScanLine(sy);
+			for (int i = 0; i < src_w * 4; i++) {
+				sum[i] += line[i];
+			}
+		}
+
+		uchar *out = dst.scanLine(y);
+		for (int x = 0; x < width; x++) {
+			int x0 = x * src_w / width;
+			int x1 = (x + 1) * src_w / width;
+			if (x1 <= x0) {
+				x1 = x0 + 1;
+			}
+			unsigned int count = (x1 - x0) * (y1 - y0);
+			unsigned int b = 0, g = 0, r = 0, a = 0;
+			for (int sx = x0; sx < x1; sx++) {
+				b += sum[sx * 4];
+				g += sum[sx * 4 + 1];
+				r += sum[sx * 4 + 2];
+				a += sum[sx * 4 + 3];
+			}
+			out[x * 4] = (b + count / 2) / count;
+			out[x * 4 + 1] = (g + count / 2) / count;
+			out[x * 4 + 2] = (r + count / 2) / count;
+			out[x * 4 + 3] = (a + count / 2) / count;
+		}
+	}
+	return dst;
+}
+
 void add_action(QWidget *base, const char *action, const char *slot, QWidget *receiver) {
 	QStringListIterator i(CFG::get_instance()->get_keys(action));
 	while (i.hasNext()) {
@@ -3,6 +3,7 @@
 
 #include <QRect>
 #include <QRectF>
+#include <QImage>
 
 #define POPPLER_VERSION ((POPPLER_VERSION_MAJOR << 16) | (POPPLER_VERSION_MINOR << 8) | (POPPLER_VERSION_MICRO))
 
@@ -19,6 +20,9 @@ const QPointF rotate_point(const QPointF &point, float w, float h, int rotation)
 QRect transform_rect(const QRectF &rect, float scale, int off_x, int off_y);
 QRect transform_rect_expand(const QRectF &rect, float scale, int off_x, int off_y);
 
+// box filter, keeps the aspect ratio; width must not exceed the source width
+QImage downscale_image(const QImage &source, int width);
+
 void add_action(QWidget *base, const char *action, const char *slot, QWidget *receiver);
 
 #endif
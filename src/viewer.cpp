@@ -19,6 +19,10 @@
 #include "toc.h"
 #include "splitter.h"
 #include "util.h"
+#include "stats.h"
+#include "trace.h"
+#include "documentloader.h"
+#include "synctex.h"
 
 using namespace std;
 
@@ -35,7 +39,15 @@ Viewer::Viewer(const QString &file, QWidget *parent) :
 		layout(NULL),
 		sig_notifier(NULL),
 		beamer(NULL),
+		synctex(NULL),
+		doc_loader(NULL),
+		reload_clamp(true),
 		valid(true) {
+	// before any thread is started
+	if (!CFG::get_instance()->get_value("Settings/trace_file").toString().isEmpty()) {
+		Trace::get_instance()->start(CFG::get_instance()->get_value("Settings/trace_buffer_size").toInt());
+	}
+
 	res = new ResourceManager(file, this);
 	if (!res->is_valid()) {
 		if (CFG::get_instance()->get_most_current_value("Settings/quit_on_init_fail").toBool()) {
@@ -72,11 +84,23 @@ Viewer::Viewer(const QString &file, QWidget *parent) :
 		valid = false;
 		return;
 	}
+	// SIGUSR2 dumps the trace, keep the default action otherwise
+	if (Trace::get_instance()->is_enabled() && sigaction(SIGUSR2, &usr, 0) > 0) {
+		cerr << "sigaction: " << strerror(errno) << endl;
+		valid = false;
+		return;
+	}
 
 	setup_keys(this);
 	beamer = new BeamerWindow(this);
 	setup_keys(beamer);
 
+	// source correlation without the synctex binary
+	synctex = new Synctex(this);
+	synctex->load(res->get_file());
+	connect(res, SIGNAL(file_changed(const QString &)), synctex, SLOT(file_changed(const QString &)),
+			Qt::UniqueConnection);
+
 	splitter = new Splitter(this);
 	toc = new Toc(this, splitter);
 
@@ -167,9 +191,17 @@ Viewer::Viewer(const QString &file, QWidget *parent) :
 }
 
 Viewer::~Viewer() {
+	QString stats_file = CFG::get_instance()->get_value("Settings/stats_file").toString();
+	if (!stats_file.isEmpty()) {
+		Stats::get_instance()->write(stats_file);
+	}
+	write_trace();
+
+	delete doc_loader;
 	::close(sig_fd[0]);
 	::close(sig_fd[1]);
 	delete beamer;
+	delete synctex;
 	delete sig_notifier;
 	delete layout;
 	delete search_bar;
@@ -187,20 +219,47 @@ void Viewer::reload(bool clamp) {
 #ifdef DEBUG
 	cerr << "reloading file " << res->get_file().toUtf8().constData() << endl;
 #endif
+	if (doc_loader != NULL) {
+		// outdated, poppler can't be interrupted
+		disconnect(doc_loader, SIGNAL(finished()), this, SLOT(document_loaded()));
+		doc_loader->detach();
+	}
+
+	reload_clamp = clamp;
+	doc_loader = new DocumentLoader(res->get_file(), info_password.text().toLatin1());
+	connect(doc_loader, SIGNAL(finished()), this, SLOT(document_loaded()), Qt::UniqueConnection);
+	doc_loader->start();
+}
 
-	res->load(res->get_file(), info_password.text().toLatin1());
+void Viewer::document_loaded() {
+	// queued before the loader was detached
+	if (sender() != doc_loader) {
+		return;
+	}
+	DocumentLoader *loader = doc_loader;
+	doc_loader = NULL;
+	// also when invalid, the error is shown then
+	swap_document(loader, reload_clamp);
+	delete loader;
+}
+
+void Viewer::swap_document(DocumentLoader *loader, bool clamp) {
+	res->load(loader->get_file(), info_password.text().toLatin1(), loader);
 
 	search_bar->reset_search(); // TODO restart search if loading the same document?
-	search_bar->load(res->get_file(), info_password.text().toLatin1());
+	search_bar->load(res->get_file());
 
 	update_info_widget();
 
+	synctex->load(res->get_file());
 	toc->init();
 	canvas->get_layout()->clear_selection();
 	canvas->reload(clamp);
 
 	canvas->update_page_overlay();
  	presenter_progress.setMaximum(res->get_page_count());
+
+	emit file_loaded(res->get_file());
 }
 
 void Viewer::open(QString new_file) {
@@ -536,13 +595,18 @@ BeamerWindow *Viewer::get_beamer() const {
 	return beamer;
 }
 
+Synctex *Viewer::get_synctex() const {
+	return synctex;
+}
+
 void Viewer::layout_updated(int new_page, bool page_changed) {
+	res->interaction();
 	if (page_changed) {
 		canvas->get_layout()->scroll_page(new_page, false);
 		if (beamer->isVisible()) {
 			beamer->get_layout()->scroll_page(new_page, false);
 		}
-		// TODO unfold toc tree to show current entry?
+		toc->set_current_page(new_page);
 		canvas->update_page_overlay();
 		presenter_progress.setValue(new_page + 1);
 	}
@@ -561,18 +625,29 @@ void Viewer::signal_slot() {
 		cerr << "read: " << strerror(errno) << endl;
 	}
 
-	reload();
+	if (tmp == '2') {
+		write_trace();
+	} else {
+		reload();
+	}
 
 	sig_notifier->setEnabled(true);
 }
 
-void Viewer::signal_handler(int /*unused*/) {
-	char tmp = '1';
+void Viewer::signal_handler(int signum) {
+	char tmp = signum == SIGUSR2 ? '2' : '1';
 	if (write(sig_fd[0], &tmp, sizeof(char)) < 0) {
 		cerr << "write: " << strerror(errno) << endl;
 	}
 }
 
+void Viewer::write_trace() {
+	QString trace_file = CFG::get_instance()->get_value("Settings/trace_file").toString();
+	if (!trace_file.isEmpty()) {
+		Trace::get_instance()->write(trace_file);
+	}
+}
+
 void Viewer::toggle_fullscreen() {
 	setWindowState(windowState() ^ Qt::WindowFullScreen);
 }
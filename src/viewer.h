@@ -16,6 +16,8 @@ class SearchBar;
 class BeamerWindow;
 class Splitter;
 class Toc;
+class DocumentLoader;
+class Synctex;
 
 
 class Viewer : public QWidget {
@@ -31,17 +33,25 @@ public:
 	Canvas *get_canvas() const;
 	SearchBar *get_search_bar() const;
 	BeamerWindow *get_beamer() const;
+	Synctex *get_synctex() const;
 
 	void layout_updated(int new_page, bool page_changed);
 	void show_progress(bool show);
+	// replaces the shown document with a finished background parse
+	void swap_document(DocumentLoader *loader, bool clamp);
 
 public slots:
-	void signal_slot(); // reloads on SIGUSR1
+	void signal_slot(); // reloads on SIGUSR1, writes the trace on SIGUSR2
 
 	void reload(bool clamp = true);
 	void open(QString filename);
 
+signals:
+	// after a document is (re)loaded and shown
+	void file_loaded(const QString &file);
+
 private slots:
+	void document_loaded();
 	// movement
 	void page_up();
 	void page_down();
@@ -109,11 +119,17 @@ private:
 	QLineEdit info_password;
 
 	// signal handling
-	static void signal_handler(int unused);
+	static void signal_handler(int signum);
+	void write_trace();
 	static int sig_fd[2];
 	QSocketNotifier *sig_notifier;
 
 	BeamerWindow *beamer;
+	Synctex *synctex;
+
+	// parses on reload, the old document is shown meanwhile
+	DocumentLoader *doc_loader;
+	bool reload_clamp;
 
 	bool valid;
 };
@@ -3,16 +3,83 @@
 #include "kpage.h"
 #include "canvas.h"
 #include "selection.h"
+#include "util.h"
+#include "shmcache.h"
+#include "rangesource.h"
+#include "stats.h"
+#include "trace.h"
 #include <list>
+#include <cmath>
+#include <cstdlib>
+#include <QTime>
 #include <iostream>
 #include <poppler/qt4/poppler-qt4.h>
 
 using namespace std;
 
 
+// takes the visible request that renders fastest out of requests
+// unknown costs count as cheap, ties go to the page closest to center_page
+static bool pop_cheapest(map<int,RenderRequest> &requests,
+		int center_page, int &page, int &index, int &width) {
+	if (requests.empty()) {
+		return false;
+	}
+	map<int,RenderRequest>::iterator best = requests.end();
+	int best_cost = 0, best_distance = 0;
+	for (map<int,RenderRequest>::iterator it = requests.begin(); it != requests.end(); ++it) {
+		int cost = it->second.cost;
+		int distance = abs(it->first - center_page);
+		// favour nearby page, go down first
+		if (best == requests.end() || cost < best_cost ||
+				(cost == best_cost && distance <= best_distance)) {
+			best = it;
+			best_cost = cost;
+			best_distance = distance;
+		}
+	}
+	page = best->first;
+	index = best->second.index;
+	width = best->second.width;
+	requests.erase(best);
+	return true;
+}
+
+// takes the prefetch closest to center_page out of requests
+// pages expected to take longer than max_time are deferred until nothing else is left
+// cost is -1 for exact requests, they are never considered expensive
+static bool pop_prefetch(map<int,RenderRequest> &requests,
+		int center_page, int max_time, int &page, int &index, int &width, int &cost) {
+	if (requests.empty()) {
+		return false;
+	}
+	map<int,RenderRequest>::iterator best = requests.end();
+	bool best_expensive = false;
+	int best_distance = 0;
+	for (map<int,RenderRequest>::iterator it = requests.begin(); it != requests.end(); ++it) {
+		int c = it->second.exact ? -1 : it->second.cost;
+		bool expensive = max_time > 0 && c > max_time;
+		int distance = abs(it->first - center_page);
+		if (best == requests.end() || (best_expensive && !expensive) ||
+				(expensive == best_expensive && distance <= best_distance)) {
+			best = it;
+			best_expensive = expensive;
+			best_distance = distance;
+			cost = c;
+		}
+	}
+	page = best->first;
+	index = best->second.index;
+	width = best->second.width;
+	requests.erase(best);
+	return true;
+}
+
+
 Worker::Worker(ResourceManager *res) :
 		die(false),
-		res(res) {
+		res(res),
+		fast_hints(false) {
 }
 
 void Worker::run() {
@@ -22,80 +89,152 @@ void Worker::run() {
 			break;
 		}
 
-		// get next page to render
+		// get next page to render, prefetches only when nothing visible is missing
+		Trace *trace = Trace::get_instance();
+		trace->begin("pop");
 		res->requestMutex.lock();
+		Stats::get_instance()->record_queue(res->requests.size() + res->prefetch_requests.size());
 		int page, width, index;
-		map<int,pair<int,int> >::iterator less = res->requests.lower_bound(res->center_page);
-		map<int,pair<int,int> >::iterator greater = less--;
-
-		if (greater != res->requests.end()) {
-			if (greater != res->requests.begin()) {
-				// favour nearby page, go down first
-				if (greater->first + less->first <= res->center_page * 2) {
-					page = greater->first;
-					index = greater->second.first;
-					width = greater->second.second;
-					res->requests.erase(greater);
-				} else {
-					page = less->first;
-					index = less->second.first;
-					width = less->second.second;
-					res->requests.erase(less);
+		bool found = pop_cheapest(res->requests, res->center_page, page, index, width);
+		if (!found) {
+			int cost = -1;
+			found = pop_prefetch(res->prefetch_requests, res->center_page,
+					res->prefetch_max_time, page, index, width, cost);
+			// expensive pages are prefetched at a lower resolution,
+			// becoming visible requests the exact size
+			if (found && res->prefetch_max_time > 0 && cost > res->prefetch_max_time) {
+				float factor = sqrt((float) res->prefetch_max_time / cost);
+				if (factor < 0.25f) {
+					factor = 0.25f;
 				}
-			} else {
-				page = greater->first;
-				index = greater->second.first;
-				width = greater->second.second;
-				res->requests.erase(greater);
+				width *= factor;
 			}
-		} else {
-			page = less->first;
-			index = less->second.first;
-			width = less->second.second;
-			res->requests.erase(less);
 		}
 		res->requestMutex.unlock();
+		trace->end("pop");
+		if (!found) {
+			continue;
+		}
+		TraceScope scope("page", page);
+
+		// render profile for this page, fast while the user is scrolling
+		bool fast = res->fast_rendering;
 
 		// check for duplicate requests
 		res->k_page[page].mutex.lock();
 		if (res->k_page[page].status[index] == width &&
-				res->k_page[page].rotation[index] == res->rotation) {
+				res->k_page[page].rotation[index] == res->rotation &&
+				(!res->k_page[page].fast[index] || fast)) {
 			res->k_page[page].mutex.unlock();
 			continue;
 		}
 		int rotation = res->rotation;
+
+		// a bigger rendering for another index can be scaled down instead,
+		// e.g. the beamer's slide for the presenter view
+		QImage source;
+		int source_width = 0;
+		bool source_fast = false;
+		bool source_inverted = res->k_page[page].inverted_colors;
+		for (int i = 0; i < 3; i++) {
+			if (i != index && !res->k_page[page].img[i].isNull() &&
+					res->k_page[page].status[i] > width &&
+					res->k_page[page].rotation[i] == rotation &&
+					(!res->k_page[page].fast[i] || fast) &&
+					(source.isNull() || res->k_page[page].status[i] < source_width)) {
+				source = res->k_page[page].img[i]; // shallow copy
+				source_width = res->k_page[page].status[i];
+				source_fast = res->k_page[page].fast[i];
+			}
+		}
 		res->k_page[page].mutex.unlock();
 
-		// open page
+		Poppler::Page *p = NULL;
+		QImage img;
+		int render_time = -1;
+		if (!source.isNull()) {
 #ifdef DEBUG
-		cerr << "    rendering page " << page << " for index " << index << endl;
+			cerr << "    scaling page " << page << " for index " << index << endl;
 #endif
-		Poppler::Page *p = res->doc->page(page);
-		if (p == NULL) {
-			cerr << "failed to load page " << page << endl;
-			continue;
-		}
+			trace->begin("downscale", page);
+			img = downscale_image(source, width);
+			trace->end("downscale", page);
+			if (source_inverted != res->inverted_colors) {
+				TraceScope invert_scope("invert", page);
+				img.invertPixels();
+			}
+			fast = source_fast;
+		} else if (res->shm_cache != NULL && !fast &&
+				res->shm_cache->get(page, width, rotation, img)) {
+			// rendered by another instance showing the same file
+			if (res->inverted_colors) {
+				TraceScope invert_scope("invert", page);
+				img.invertPixels();
+			}
+		} else {
+			// open page
+#ifdef DEBUG
+			cerr << "    rendering page " << page << " for index " << index << endl;
+#endif
+			trace->begin("load", page);
+			if (res->range_source != NULL) {
+				res->range_source->fetch_page(page);
+			}
+			p = res->doc->page(page);
+			trace->end("load", page);
+			if (p == NULL) {
+				cerr << "failed to load page " << page << endl;
+				continue;
+			}
+
+			if (fast != fast_hints) {
+				res->set_render_hints(fast);
+				fast_hints = fast;
+			}
 
-		// render page
-		float dpi = 72.0 * width / res->get_page_width(page);
-		QImage img = p->renderToImage(dpi, dpi, -1, -1, -1, -1,
-				static_cast<Poppler::Page::Rotation>(rotation));
+			// render page
+			QTime timer;
+			timer.start();
+			trace->begin("render", page);
+			float dpi = 72.0 * width / res->get_page_width(page);
+			img = p->renderToImage(dpi, dpi, -1, -1, -1, -1,
+					static_cast<Poppler::Page::Rotation>(rotation));
+			trace->end("render", page);
+			render_time = timer.elapsed();
+			Stats::get_instance()->record_render(render_time);
 
-		if (img.isNull()) {
-			cerr << "failed to render page " << page << endl;
-			continue;
-		}
+			if (img.isNull()) {
+				cerr << "failed to render page " << page << endl;
+				delete p;
+				continue;
+			}
+
+			// learn the cost of this page, fast renderings would skew it
+			if (!fast) {
+				res->costMutex.lock();
+				res->k_page[page].costs[(int) ROUND(dpi)] = make_pair(render_time, img.width() * img.height());
+				res->costMutex.unlock();
+
+				if (res->shm_cache != NULL) {
+					res->shm_cache->put(page, width, rotation, img);
+				}
+			}
 
-		// invert to current color setting
-		if (res->inverted_colors) {
-			img.invertPixels();
+			// invert to current color setting
+			if (res->inverted_colors) {
+				TraceScope invert_scope("invert", page);
+				img.invertPixels();
+			}
 		}
 
 		// put page
 		res->k_page[page].mutex.lock();
+		int freed_bytes = 0;
 		if (!res->k_page[page].img[index].isNull()) {
+			freed_bytes = res->k_page[page].img[index].byteCount();
 			res->k_page[page].img[index] = QImage(); // assign null image
 		}
+		Stats::get_instance()->add_image_bytes(img.byteCount() - freed_bytes);
 
 		// adjust all available images to current color setting
 		if (res->k_page[page].inverted_colors != res->inverted_colors) {
@@ -108,6 +247,11 @@ void Worker::run() {
 		res->k_page[page].img[index] = img;
 		res->k_page[page].status[index] = width;
 		res->k_page[page].rotation[index] = rotation;
+		res->k_page[page].fast[index] = fast;
+		// only full quality timings decide about direct painting
+		if (render_time >= 0 && !fast) {
+			res->k_page[page].render_time = render_time;
+		}
 		res->k_page[page].mutex.unlock();
 
 		res->garbageMutex.lock();
@@ -116,14 +260,33 @@ void Worker::run() {
 
 		emit page_rendered(page);
 
+		// links and text may have been collected along with another rendering
+		if (p == NULL) {
+			res->link_mutex.lock();
+			bool collected = res->k_page[page].links != NULL && res->k_page[page].text != NULL;
+			res->link_mutex.unlock();
+			if (collected) {
+				continue;
+			}
+			if (res->range_source != NULL) {
+				res->range_source->fetch_page(page);
+			}
+			p = res->doc->page(page);
+			if (p == NULL) {
+				continue;
+			}
+		}
+
 		// collect goto links
 		res->link_mutex.lock();
 		if (res->k_page[page].links == NULL) {
 			res->link_mutex.unlock();
 
+			trace->begin("links", page);
 			QList<Poppler::Link *> *links = new QList<Poppler::Link *>;
 			QList<Poppler::Link *> l = p->links();
 			links->swap(l);
+			trace->end("links", page);
 
 			res->link_mutex.lock();
 			res->k_page[page].links = links;
@@ -131,6 +294,7 @@ void Worker::run() {
 		if (res->k_page[page].text == NULL) {
 			res->link_mutex.unlock();
 
+			trace->begin("text", page);
 			QList<Poppler::TextBox *> text = p->textList();
 			// assign boxes to lines
 			// make single parts from chained boxes
@@ -188,6 +352,7 @@ void Worker::run() {
 			if (!lines->empty()) {
 				lines->back()->sort();
 			}
+			trace->end("text", page);
 
 			res->link_mutex.lock();
 			res->k_page[page].text = lines;
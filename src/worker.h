@@ -22,6 +22,7 @@ signals:
 
 private:
 	ResourceManager *res;
+	bool fast_hints; // profile the document's render hints are set to
 };
 
 #endif